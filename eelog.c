@@ -0,0 +1,419 @@
+/************************************************************/
+/* Implementierung von eelog.h								*/
+/*															*/
+/************************************************************/
+
+#ifdef EELOG
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/eeprom.h>
+#include <util/atomic.h>
+#include "eelog.h"
+
+#if ((EELOG_RECORDS % 64) == 0)
+#error "Die Anzahl Eintrge darf kein Vielfaches von 64 sein, sonst ist das Ringende nicht eindeutig"
+#endif
+
+// Typ eines Eintrags (untere 2 Bits des Kopfbytes)
+#define REC_DELTA	0	// Daten: Differenz zum vorherigen Wert (int8)
+#define REC_ABS_HI	1	// Daten: oberes Byte des absoluten Werts
+#define REC_ABS_LO	2	// Daten: unteres Byte, folgt immer auf REC_ABS_HI
+#define REC_EMPTY	3	// gelschte Zelle (0xFF)
+
+#define REC_HEADER(seq,type) ((uint8_t)(((seq)<<2)|(type)))
+#define REC_SEQ(h) ((h)>>2)
+#define REC_TYPE(h) ((h)&0x03)
+
+#define EELOG_MAGIC 0x5A
+
+// Warteschlange der Eintrge fr die ISR (Ringindex, Kopfbyte, Datenbyte)
+#define EELOG_QUEUE 8
+static struct
+{
+	uint8_t Ix;
+	uint8_t Hdr;
+	uint8_t Data;
+} _loc_Queue[EELOG_QUEUE];
+static volatile uint8_t _loc_QHead = 0;
+static volatile uint8_t _loc_QTail = 0;
+static uint8_t _loc_QPhase = 0;			// 0 = Kopfbyte, 1 = Datenbyte (nur ISR)
+
+// Blockauftrag fr Statistik, Kalibrierdaten und das Formatieren (Src==0 -> 0xFF)
+static const uint8_t * volatile _loc_BlkSrc;
+static volatile uint16_t _loc_BlkAddr;
+static volatile uint16_t _loc_BlkLen = 0;
+static volatile uint8_t _loc_Formatting = 0;
+
+// Zustand des Rings
+static uint8_t _loc_Ix = 0;				// nchster freier Eintrag
+static uint8_t _loc_Seq = 0;			// Sequenz des nchsten Eintrags
+static uint8_t _loc_SinceAbs = 0xFF;	// Differenzen seit dem letzten absoluten Wert
+static uint16_t _loc_Last = 0;			// zuletzt gespeicherter Wert (skaliert)
+static uint8_t _loc_Div = 0;
+static uint16_t _loc_Drops = 0;
+
+// Statistik, wird als Block ins EEPROM geschrieben
+static struct
+{
+	uint8_t Magic;
+	uint16_t Min;
+	uint16_t Max;
+	uint8_t Chk;
+} _loc_Stats, _loc_StatsImg;		// Abbild fr die ISR, nur ndern solange kein Block luft
+static uint8_t _loc_StatsDirty = 0;
+
+// Lesen aus dem Hauptprogramm: die ISR darf EEAR nicht zwischen Adresse und
+// Lesebefehl umstellen, gesperrt wird aber nur kurz und nie whrend eines Schreibvorgangs
+static uint8_t _loc_RdByte(uint16_t addr)
+{
+	uint8_t Data = 0, Done = 0;
+	
+	while (!Done)
+	{
+		ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+		{
+			if (!(EECR&(1<<EEWE)))
+			{
+				EEAR=addr;
+				EECR|=(1<<EERE);
+				Data=EEDR;
+				Done=1;
+			}
+		}
+	}
+	return Data;
+}
+
+static uint8_t _loc_StatsChk(void)
+{
+	return EELOG_MAGIC^_loc_Stats.Min^(_loc_Stats.Min>>8)^_loc_Stats.Max^(_loc_Stats.Max>>8);
+}
+
+// Den EE_RDY Interrupt freigeben, er lst sofort aus wenn das EEPROM frei ist
+static void _loc_Kick(void)
+{
+	EECR|=(1<<EERIE);
+}
+
+// Einen Blockauftrag starten, nur wenn kein anderer luft
+static uint8_t _loc_StartBlock(uint16_t addr, const void *src, uint16_t len)
+{
+	uint8_t Ok = 0;
+	
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		if (_loc_BlkLen==0)
+		{
+			_loc_BlkSrc=src;
+			_loc_BlkAddr=addr;
+			_loc_BlkLen=len;
+			Ok=1;
+		}
+	}
+	if (Ok) _loc_Kick();
+	return Ok;
+}
+
+// Einen Eintrag in die Warteschlange stellen
+static uint8_t _loc_Enqueue(uint8_t type, uint8_t data)
+{
+	uint8_t Head = _loc_QHead;
+	uint8_t Next = (Head+1)%EELOG_QUEUE;
+	
+	if (Next==_loc_QTail) return 0;
+	
+	_loc_Queue[Head].Ix=_loc_Ix;
+	_loc_Queue[Head].Hdr=REC_HEADER(_loc_Seq,type);
+	_loc_Queue[Head].Data=data;
+	_loc_QHead=Next;
+	
+	_loc_Ix++;
+	if (_loc_Ix>=EELOG_RECORDS) _loc_Ix=0;
+	_loc_Seq=(_loc_Seq+1)&0x3F;
+	return 1;
+}
+
+// Freie Pltze in der Warteschlange
+static uint8_t _loc_QueueFree(void)
+{
+	return (uint8_t)(_loc_QTail+EELOG_QUEUE-_loc_QHead-1)%EELOG_QUEUE;
+}
+
+void eelog_Init(void)
+{
+	uint8_t i, Next, h, hn;
+	
+	eeprom_busy_wait();
+	
+	// Statistik laden, fehlende Kennung -> EEPROM ist nicht formatiert
+	eeprom_read_block(&_loc_Stats,(const void *)EELOG_STATS_ADDR,sizeof(_loc_Stats));
+	if (_loc_Stats.Magic!=EELOG_MAGIC)
+	{
+		_loc_Stats.Magic=EELOG_MAGIC;
+		_loc_Stats.Min=0;
+		_loc_Stats.Max=0;
+		_loc_Stats.Chk=_loc_StatsChk();
+		_loc_StatsDirty=1;
+		
+		// Ring im Hintergrund lschen, erst danach die Statistik mit der Kennung schreiben
+		_loc_StatsImg=_loc_Stats;
+		_loc_Formatting=1;
+		_loc_StartBlock(EELOG_RING_ADDR,0,EELOG_RING_END-EELOG_RING_ADDR);
+		return;
+	}
+	
+	// Prfsumme falsch: Statistik beim Schreiben unterbrochen (Spannungsausfall).
+	// Die Kennung ndert sich dabei nie, der Ring ist gltig und bleibt erhalten.
+	if (_loc_Stats.Chk!=_loc_StatsChk())
+	{
+		_loc_Stats.Min=0;
+		_loc_Stats.Max=0;
+		_loc_StatsDirty=1;
+	}
+	
+	// Neuesten Eintrag suchen: der Nachfolger ist leer oder passt nicht in die Sequenz
+	for (i=0;i<EELOG_RECORDS;i++)
+	{
+		h=_loc_RdByte(EELOG_RING_ADDR+2*i);
+		if (REC_TYPE(h)==REC_EMPTY) continue;
+		
+		Next=(i+1<EELOG_RECORDS)?(i+1):0;
+		hn=_loc_RdByte(EELOG_RING_ADDR+2*Next);
+		if ((REC_TYPE(hn)==REC_EMPTY) || (REC_SEQ(hn)!=((REC_SEQ(h)+1)&0x3F)))
+		{
+			_loc_Ix=Next;
+			_loc_Seq=(REC_SEQ(h)+1)&0x3F;
+			break;
+		}
+	}
+	
+	// Letzten Wert fr die Differenzbildung rekonstruieren, sonst folgt ein absoluter Wert
+	if (eelog_History(&_loc_Last,1)) _loc_SinceAbs=0;
+	_loc_Last>>=EELOG_RPM_SHIFT;
+}
+
+uint8_t eelog_Put(uint16_t rpm)
+{
+	uint16_t v;
+	int16_t d;
+	uint8_t Ok = 1;
+	
+	// Statistik nachfhren
+	if (rpm)
+	{
+		if ((_loc_Stats.Min==0) || (rpm<_loc_Stats.Min)) { _loc_Stats.Min=rpm; _loc_StatsDirty=1; }
+		if (rpm>_loc_Stats.Max) { _loc_Stats.Max=rpm; _loc_StatsDirty=1; }
+	}
+	
+	if (++_loc_Div<EELOG_DIVIDER) return 1;
+	_loc_Div=0;
+	
+	// Whrend dem Formatieren wird nichts gespeichert
+	if (_loc_Formatting)
+	{
+		_loc_Drops++;
+		return 0;
+	}
+	
+	v=rpm>>EELOG_RPM_SHIFT;
+	d=(int16_t)(v-_loc_Last);
+	
+	if ((_loc_SinceAbs<EELOG_ABS_EVERY) && (d>=-128) && (d<=127))
+	{
+		if (_loc_QueueFree()>=1)
+		{
+			_loc_Enqueue(REC_DELTA,(uint8_t)d);
+			_loc_SinceAbs++;
+			_loc_Last=v;
+		}
+		else Ok=0;
+	}
+	else
+	{
+		if (_loc_QueueFree()>=2)
+		{
+			_loc_Enqueue(REC_ABS_HI,v>>8);
+			_loc_Enqueue(REC_ABS_LO,v&0xFF);
+			_loc_SinceAbs=0;
+			_loc_Last=v;
+		}
+		else Ok=0;
+	}
+	if (!Ok) _loc_Drops++;
+	
+	// Statistik nur zusammen mit einem Eintrag schreiben, das begrenzt die Schreibrate
+	// Die ISR liest aus dem Abbild, Min/Max knnen sich whrenddessen weiter ndern
+	if (_loc_StatsDirty)
+	{
+		ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+		{
+			if (_loc_BlkLen==0)
+			{
+				_loc_Stats.Chk=_loc_StatsChk();
+				_loc_StatsImg=_loc_Stats;
+				_loc_StatsDirty=0;
+			}
+		}
+		if (!_loc_StatsDirty) _loc_StartBlock(EELOG_STATS_ADDR,&_loc_StatsImg,sizeof(_loc_StatsImg));
+	}
+	
+	_loc_Kick();
+	return Ok;
+}
+
+uint8_t eelog_History(uint16_t *dst, uint8_t max)
+{
+	uint8_t i, k, Ix, h, d, n = 0;
+	uint8_t Valid = 0, Hi = 0, HaveHi = 0;
+	uint16_t v = 0;
+	
+	if (max==0) return 0;
+	
+	// Vom ltesten Eintrag (= _loc_Ix) bis zum neuesten, Differenzen erst nach dem ersten absoluten Wert
+	Ix=_loc_Ix;
+	for (i=0;i<EELOG_RECORDS;i++)
+	{
+		h=_loc_RdByte(EELOG_RING_ADDR+2*Ix);
+		d=_loc_RdByte(EELOG_RING_ADDR+2*Ix+1);
+		Ix++;
+		if (Ix>=EELOG_RECORDS) Ix=0;
+		
+		switch (REC_TYPE(h))
+		{
+			case REC_ABS_HI:
+				Hi=d;
+				HaveHi=1;
+				continue;
+			case REC_ABS_LO:
+				if (!HaveHi) continue;
+				v=((uint16_t)Hi<<8)|d;
+				Valid=1;
+			break;
+			case REC_DELTA:
+				if (!Valid) continue;
+				v+=(int8_t)d;
+			break;
+			default:
+				continue;
+		}
+		HaveHi=0;
+		
+		// Nur die neuesten max Werte behalten
+		if (n==max)
+		{
+			for (k=1;k<max;k++) dst[k-1]=dst[k];
+			n--;
+		}
+		dst[n++]=v<<EELOG_RPM_SHIFT;
+	}
+	return n;
+}
+
+uint16_t eelog_Min(void)
+{
+	return _loc_Stats.Min;
+}
+
+uint16_t eelog_Max(void)
+{
+	return _loc_Stats.Max;
+}
+
+void eelog_ResetStats(void)
+{
+	_loc_Stats.Min=0;
+	_loc_Stats.Max=0;
+	_loc_StatsDirty=1;
+}
+
+uint8_t eelog_CalWrite(uint8_t ofs, const void *src, uint8_t len)
+{
+	if ((uint16_t)ofs+len>EELOG_CAL_SIZE) return 0;
+	return _loc_StartBlock(EELOG_CAL_ADDR+ofs,src,len);
+}
+
+void eelog_CalRead(uint8_t ofs, void *dst, uint8_t len)
+{
+	uint8_t *p=(uint8_t *)dst;
+	
+	while (len--) *p++=_loc_RdByte(EELOG_CAL_ADDR+ofs++);
+}
+
+uint8_t eelog_Busy(void)
+{
+	uint8_t Busy;
+	
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		Busy=(_loc_QHead!=_loc_QTail) || (_loc_BlkLen!=0);
+	}
+	return Busy;
+}
+
+uint16_t eelog_Drops(void)
+{
+	return _loc_Drops;
+}
+
+// EEPROM bereit: nchstes Byte schreiben
+// Bytes, die bereits den gewnschten Wert haben, werden bersprungen (schont die Zellen).
+// Pro Aufruf nur eine Adresse: der Interrupt ist pegelgesteuert und kommt sofort
+// wieder, dazwischen wird der hherpriore Timer1 Interrupt bedient. Eine Schleife
+// ber lauter gleiche Bytes (Formatieren) wrde die Interrupts fr ms sperren.
+ISR(EE_RDY_vect)
+{
+	uint16_t Addr;
+	uint8_t Data, Tail;
+	
+	Tail=_loc_QTail;
+	if (Tail!=_loc_QHead)
+	{
+		// Eintrge: zuerst das Datenbyte, dann das Kopfbyte. So ist ein Eintrag
+		// erst gltig, wenn beide Bytes geschrieben sind.
+		Addr=EELOG_RING_ADDR+2*_loc_Queue[Tail].Ix;
+		if (_loc_QPhase==0)
+		{
+			Addr++;
+			Data=_loc_Queue[Tail].Data;
+			_loc_QPhase=1;
+		}
+		else
+		{
+			Data=_loc_Queue[Tail].Hdr;
+			_loc_QPhase=0;
+			_loc_QTail=(Tail+1)%EELOG_QUEUE;
+		}
+	}
+	else if (_loc_BlkLen)
+	{
+		Addr=_loc_BlkAddr++;
+		Data=_loc_BlkSrc?*_loc_BlkSrc++:0xFF;
+		_loc_BlkLen--;
+		if ((_loc_BlkLen==0) && _loc_Formatting)
+		{
+			// Ring ist gelscht, jetzt die Statistik mit der Kennung schreiben
+			_loc_Formatting=0;
+			// Abbild aus eelog_Init, sptere nderungen schreibt das nchste eelog_Put
+			_loc_BlkSrc=(const uint8_t *)&_loc_StatsImg;
+			_loc_BlkAddr=EELOG_STATS_ADDR;
+			_loc_BlkLen=sizeof(_loc_StatsImg);
+		}
+	}
+	else
+	{
+		EECR&=~(1<<EERIE);
+		return;
+	}
+	
+	EEAR=Addr;
+	EECR|=(1<<EERE);
+	if (EEDR!=Data)
+	{
+		EEDR=Data;
+		EECR|=(1<<EEMWE);
+		EECR|=(1<<EEWE);
+	}
+}
+
+#endif
@@ -0,0 +1,87 @@
+/************************************************************/
+/* Drehzahl-Logbuch und Kalibrierdaten im EEPROM			*/
+/*															*/
+/* Aufteilung der 512 Bytes des ATmega16:					*/
+/*   0x000..0x03F  Kalibrierdaten (frei verwendbar)			*/
+/*   0x040..0x045  Statistik (Kennung, Min, Max, Prfsumme)	*/
+/*   0x050..0x1FF  Ringpuffer mit 216 Eintrgen  2 Bytes		*/
+/*															*/
+/* Ein Eintrag besteht aus einem Kopfbyte (6 Bit Sequenz,	*/
+/* 2 Bit Typ) und einem Datenbyte. Normalerweise wird nur	*/
+/* die Differenz zum vorherigen Wert gespeichert, in			*/
+/* regelmssigen Abstnden ein absoluter Wert (2 Eintrge).	*/
+/* Der Ring verteilt die Schreibzugriffe gleichmssig ber	*/
+/* alle Zellen (Wear-Leveling), das Ende wird beim Start	*/
+/* ber den Sprung in der Sequenznummer gefunden.			*/
+/*															*/
+/* Geschrieben wird ausschliesslich im EE_RDY Interrupt,	*/
+/* die Aufrufer warten nie auf die ca. 8.5ms pro Byte.		*/
+/*															*/
+/* Aktiv nur mit #define EELOG								*/
+/************************************************************/
+
+#ifndef EELOG_H
+#define EELOG_H
+
+#include <stdint.h>
+
+#define EELOG_CAL_ADDR		0x000
+#define EELOG_CAL_SIZE		64
+#define EELOG_STATS_ADDR	0x040
+#define EELOG_RING_ADDR		0x050
+#define EELOG_RING_END		0x200
+#define EELOG_RECORDS		((EELOG_RING_END-EELOG_RING_ADDR)/2)
+
+// Auflsung der gespeicherten Drehzahl: 1<<EELOG_RPM_SHIFT U/min
+// Mit 2 reicht eine Differenz (int8) fr +-508 U/min
+#ifndef EELOG_RPM_SHIFT
+#define EELOG_RPM_SHIFT 2
+#endif
+
+// Nach sptestens so vielen Differenzen folgt ein absoluter Wert
+#ifndef EELOG_ABS_EVERY
+#define EELOG_ABS_EVERY 32
+#endif
+
+// Nur jeder n-te Aufruf von eelog_Put wird gespeichert
+#ifndef EELOG_DIVIDER
+#define EELOG_DIVIDER 16
+#endif
+
+// Logbuch aus dem EEPROM lesen (Ende des Rings, letzter Wert, Statistik)
+// Ist das EEPROM nicht formatiert, wird der Ring im Hintergrund gelscht (ca. 4s),
+// solange werden keine Eintrge gespeichert.
+// Ist nur die Statistik beschdigt (Prfsumme), beginnen Min/Max neu, der Ring bleibt.
+// Vor sei() bzw. bevor andere EEPROM Zugriffe laufen aufrufen.
+void eelog_Init(void);
+
+// Eine Drehzahl bergeben, gespeichert wird jeder EELOG_DIVIDER-te Wert
+// Min/Max werden bei jedem Aufruf nachgefhrt.
+// Rckgabe: 0 wenn der Eintrag mangels Platz in der Warteschlange verworfen wurde
+uint8_t eelog_Put(uint16_t rpm);
+
+// Verlauf rekonstruieren, der neueste Wert steht am Ende
+// Liest das EEPROM direkt und wartet dafr ggf. auf einen laufenden Schreibvorgang.
+// Rckgabe: Anzahl Werte in dst (hchstens max)
+uint8_t eelog_History(uint16_t *dst, uint8_t max);
+
+// Gespeicherte Minimal- und Maximaldrehzahl (> 0), 0 wenn noch keine vorhanden
+uint16_t eelog_Min(void);
+uint16_t eelog_Max(void);
+void eelog_ResetStats(void);
+
+// Kalibrierdaten im Hintergrund schreiben (ofs+len <= EELOG_CAL_SIZE)
+// src muss gltig bleiben, bis eelog_Busy() 0 liefert.
+// Rckgabe: 0 wenn gerade ein anderer Block geschrieben wird
+uint8_t eelog_CalWrite(uint8_t ofs, const void *src, uint8_t len);
+
+// Kalibrierdaten lesen (wartet ggf. auf einen laufenden Schreibvorgang)
+void eelog_CalRead(uint8_t ofs, void *dst, uint8_t len);
+
+// 1 solange noch Daten auf das Schreiben warten
+uint8_t eelog_Busy(void);
+
+// Anzahl verworfener Eintrge
+uint16_t eelog_Drops(void);
+
+#endif
@@ -0,0 +1,48 @@
+/************************************************************/
+/* Implementierung von isrprof.h							*/
+/*															*/
+/************************************************************/
+
+#ifdef ISRPROF
+
+#include <avr/io.h>
+#include <util/atomic.h>
+#include <string.h>
+#include "isrprof.h"
+
+isrprof_stat_t isrprof_Stat[ISRPROF_CHANNELS];
+
+void isrprof_Init(void)
+{
+#ifdef ISRPROF_GPIO
+	uint8_t ch;
+	
+	for (ch=0;ch<ISRPROF_CHANNELS;ch++)
+	{
+		ISRPROF_GPIO_DDR|=(1<<(ISRPROF_GPIO_BIT+ch));
+		ISRPROF_PIN_OFF(ch);
+	}
+#endif
+	isrprof_Reset();
+}
+
+void isrprof_Reset(void)
+{
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		memset(isrprof_Stat,0,sizeof(isrprof_Stat));
+	}
+}
+
+uint8_t isrprof_Get(uint8_t ch, isrprof_stat_t *dst)
+{
+	if (ch>=ISRPROF_CHANNELS) return 0;
+	
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		memcpy(dst,&isrprof_Stat[ch],sizeof(isrprof_stat_t));
+	}
+	return 1;
+}
+
+#endif
@@ -0,0 +1,128 @@
+/************************************************************/
+/* Laufzeitmessung der Interrupt-Service-Routinen			*/
+/*															*/
+/* Pro ISR (Kanal) werden Latenz (Compare- bzw. Capture-	*/
+/* Zeitpunkt bis ISR-Eintritt) und Ausfhrungszeit in		*/
+/* Histogrammen mit fester Klassenbreite gesammelt, dazu	*/
+/* der Worst-Case.											*/
+/* Zeitbasis ist TCNT1 (Vorteiler 8 -> 0.667us bei 12 MHz).	*/
+/*															*/
+/* Aktiv nur mit #define ISRPROF							*/
+/* Mit #define ISRPROF_GPIO wird zustzlich pro Kanal ein	*/
+/* Pin fr die Dauer der ISR gesetzt (Messung mit Oszi).	*/
+/************************************************************/
+
+#ifndef ISRPROF_H
+#define ISRPROF_H
+
+#include <stdint.h>
+#include <avr/io.h>
+
+// Kanle
+// TIMER0_COMP wird nicht gemessen: die Motor-PWM luft in Hardware (OC0), OCIE0 ist nie
+// gesetzt und die ISR wird nicht aufgerufen.
+#define ISRPROF_CH_TIMER1 0		// Abtast-Tick (TIMER1_COMPB), Latenz TCNT1-OCR1B
+#define ISRPROF_CH_CAPT 1		// Flanke im EVENT-Betrieb (TIMER1_CAPT), Latenz TCNT1-ICR1
+#define ISRPROF_CHANNELS 2
+
+// Histogramm: Anzahl Klassen und Klassenbreite als Zweierpotenz in Timer1-Ticks
+// Die letzte Klasse sammelt alle grsseren Werte.
+#ifndef ISRPROF_BUCKETS
+#define ISRPROF_BUCKETS 8
+#endif
+#ifndef ISRPROF_BUCKET_SHIFT
+#define ISRPROF_BUCKET_SHIFT 3		// 8 Ticks = 5.3us pro Klasse
+#endif
+
+// Latenz-Budget in Timer1-Ticks, berschreitungen werden gezhlt
+#ifndef ISRPROF_BUDGET
+#define ISRPROF_BUDGET 75			// 50us = halbe Abtastperiode
+#endif
+
+// GPIO-Modus: Kanal n setzt Bit (ISRPROF_GPIO_BIT+n) im Port
+#ifndef ISRPROF_GPIO_PORT
+#define ISRPROF_GPIO_PORT PORTC
+#define ISRPROF_GPIO_PORTC		// Standardport, main.c prft dann auf berschneidungen
+#endif
+#ifndef ISRPROF_GPIO_DDR
+#define ISRPROF_GPIO_DDR DDRC
+#endif
+#ifndef ISRPROF_GPIO_BIT
+#define ISRPROF_GPIO_BIT 0
+#endif
+
+typedef struct
+{
+	uint16_t Lat[ISRPROF_BUCKETS];	// Histogramm der Latenz (jede Klasse bleibt bei 0xFFFF stehen)
+	uint16_t Exe[ISRPROF_BUCKETS];	// Histogramm der Ausfhrungszeit (ebenso)
+	uint16_t LatMax;				// grsste Latenz in Ticks
+	uint16_t ExeMax;				// grsste Ausfhrungszeit in Ticks
+	uint16_t Over;					// Anzahl Latenzen > ISRPROF_BUDGET (bleibt bei 0xFFFF stehen)
+	uint16_t Cnt;					// Anzahl Aufrufe (bleibt bei 0xFFFF stehen)
+} isrprof_stat_t;
+
+#ifdef ISRPROF
+
+extern isrprof_stat_t isrprof_Stat[ISRPROF_CHANNELS];
+
+// Einen Messwert eintragen, wird von ISRPROF_EXIT aufgerufen
+// inline, damit die ISR keine Funktion aufrufen muss (sonst sichert der
+// Compiler alle Register und die Messung verflscht das Ergebnis)
+static inline void isrprof_Add(uint8_t ch, uint16_t lat, uint16_t exe)
+{
+	isrprof_stat_t *p = &isrprof_Stat[ch];
+	uint16_t b;
+	
+	// Zhler bleiben einzeln bei 0xFFFF stehen, Maxima und berschreitungen laufen immer weiter
+	if (p->Cnt!=0xFFFF) p->Cnt++;
+	
+	b=lat>>ISRPROF_BUCKET_SHIFT;
+	if (b>=ISRPROF_BUCKETS) b=ISRPROF_BUCKETS-1;
+	if (p->Lat[b]!=0xFFFF) p->Lat[b]++;
+	if (lat>p->LatMax) p->LatMax=lat;
+	if ((lat>ISRPROF_BUDGET) && (p->Over!=0xFFFF)) p->Over++;
+	
+	b=exe>>ISRPROF_BUCKET_SHIFT;
+	if (b>=ISRPROF_BUCKETS) b=ISRPROF_BUCKETS-1;
+	if (p->Exe[b]!=0xFFFF) p->Exe[b]++;
+	if (exe>p->ExeMax) p->ExeMax=exe;
+}
+
+#ifdef ISRPROF_GPIO
+#define ISRPROF_PIN_ON(ch) (ISRPROF_GPIO_PORT|=(1<<(ISRPROF_GPIO_BIT+(ch))))
+#define ISRPROF_PIN_OFF(ch) (ISRPROF_GPIO_PORT&=~(1<<(ISRPROF_GPIO_BIT+(ch))))
+#else
+#define ISRPROF_PIN_ON(ch)
+#define ISRPROF_PIN_OFF(ch)
+#endif
+
+// Am Anfang der ISR: Zeitstempel nehmen, lat ist die Latenz in Timer1-Ticks
+// (z.B. TCNT1-OCR1B fr den Compare-Interrupt von Timer1)
+#define ISRPROF_ENTER(ch, lat) \
+	uint16_t _isrprof_t0 = TCNT1; \
+	uint16_t _isrprof_lat = (lat); \
+	ISRPROF_PIN_ON(ch)
+
+// Am Ende der ISR (vor einem eventuellen Rcksetzen von TCNT1)
+#define ISRPROF_EXIT(ch) \
+	ISRPROF_PIN_OFF(ch); \
+	isrprof_Add((ch), _isrprof_lat, TCNT1-_isrprof_t0)
+
+#else
+
+#define ISRPROF_ENTER(ch, lat)
+#define ISRPROF_EXIT(ch)
+
+#endif
+
+// Pins im GPIO-Modus als Ausgang schalten und alle Statistiken lschen
+void isrprof_Init(void);
+
+// Alle Statistiken lschen
+void isrprof_Reset(void);
+
+// Statistik eines Kanals konsistent (mit gesperrten Interrupts) kopieren
+// Rckgabe: 0 wenn der Kanal ungltig ist
+uint8_t isrprof_Get(uint8_t ch, isrprof_stat_t *dst);
+
+#endif
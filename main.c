@@ -10,12 +10,47 @@
 
 #include <avr/io.h>
 
+#include "messcfg.h"
 #include "zkslibdisplay.h"
+#include "stackmon.h"
+#include "isrprof.h"
+#include "telemetry.h"
+#include "eelog.h"
+#include "motorcal.h"
+#include "tacho.h"
+#include "quad.h"
+#include "power.h"
+#include "vibra.h"
+#include "slotmon.h"
+#include "trace.h"
+#include "softstart.h"
 #include <avr/interrupt.h>
 #include <util/delay.h>
+#include <util/atomic.h>
 
+// Alle Zeitbasen laufen ueber systick, die Module muessen dieselbe Tickdauer annehmen
+#if (DISP_TICK_US * MESS_TICK_HZ) != 1000000UL
+#error "DISP_TICK_US passt nicht zu MESS_TICK_HZ"
+#endif
+#if (MOTORCAL_TICK_US * MESS_TICK_HZ) != 1000000UL
+#error "MOTORCAL_TICK_US passt nicht zu MESS_TICK_HZ"
+#endif
 
-int count;
+// Der 8-Bit Bus belegt den ganzen Port, die Pins des Profilers wuerden mitten in die Uebertragung schalten
+#if defined(DISP_BUS8) && defined(DISP_PORT8_PORTC) && defined(ISRPROF) && defined(ISRPROF_GPIO) && defined(ISRPROF_GPIO_PORTC)
+#error "DISP_BUS8 und ISRPROF_GPIO liegen beide auf PORTC, DISP_PORT8 oder ISRPROF_GPIO_PORT umlegen"
+#endif
+
+// Sollwert in U/min: Vorsteuerung ueber die Kennlinie (motorcal), Anzeige und Telemetrie
+#ifndef MOTOR_SOLL_RPM
+#define MOTOR_SOLL_RPM 6000
+#endif
+#if (MOTOR_SOLL_RPM < 0) || (MOTOR_SOLL_RPM > 32767)
+#error "MOTOR_SOLL_RPM muss zwischen 0 und 32767 liegen"
+#endif
+
+
+volatile uint16_t count;
 int pwmtest;
 int lichtschranke;
 int save;
@@ -25,6 +60,142 @@ int umdrehung;
 int drehzahl;
 int MotorOCR;
 
+// Freilaufender Tick-Zaehler (0.1ms), Zeitbasis fuer die Display-Initialisierung
+volatile uint16_t systick;
+
+// Abtast-Ticks seit dem letzten Impuls, nach MESS_STALL_TICKS meldet der Timer-Interrupt Stillstand
+volatile uint16_t stilltick;
+volatile uint8_t stillstand;
+
+// Stillstand bei eingeschaltetem Motor (blockiert oder Lichtschranke ausgefallen)
+uint8_t blockiert;
+
+#ifdef EVENT
+#if !defined(TACHO) || (TACHO_CHANNELS > 1)
+#error "EVENT benoetigt TACHO mit einem Kanal, die Lichtschranke liegt an ICP1 (PD6)"
+#endif
+
+// Zeitstempel aus der Input-Capture-ISR, werden in der Hauptschleife ausgewertet
+#define ERFASSUNG_N 8
+volatile uint16_t erfassung[ERFASSUNG_N];
+volatile uint8_t erfassung_kopf;
+volatile uint8_t erfassung_schwanz;
+volatile uint16_t erfassung_verloren;
+#endif
+
+#if defined(VIBRA) && !defined(TACHO)
+#error "VIBRA braucht TACHO, ausgewertet werden die Perioden von Kanal 0"
+#endif
+
+#if defined(SLOTMON) && !defined(TACHO)
+#error "SLOTMON braucht TACHO, ueberwacht wird die Lichtschranke von Kanal 0"
+#endif
+
+// IDs der Anzeigefelder
+#define FELD_IST 0
+#define FELD_SOLL 1
+#define FELD_STACK 2
+
+// Hauptanzeige: das HD44780 falls eingebunden, sonst das Nokia
+// Mit DISP_MULTI und beiden Typen zeigt das Nokia zusaetzlich eine Detailseite
+#ifdef DISP_MEGACARD
+#define HAUPT_ZEILEN DISP_LCD_LINES
+#define HAUPT_SPALTEN DISP_LCD_COLS
+#define HAUPT_OPS display_OpsLcd
+#else
+#define HAUPT_ZEILEN DISP_NOKIA_LINES
+#define HAUPT_SPALTEN DISP_NOKIA_COLS
+#define HAUPT_OPS display_OpsNokia
+#endif
+#if defined(DISP_MULTI) && defined(DISP_MEGACARD) && defined(DISP_NOKIA)
+#define DETAIL
+#define FELD_PWM 3
+#ifdef DISP_BIGNUM
+#define DZEILE_SOLL (1+DISP_BIG_HEIGHT)
+#else
+#define DZEILE_SOLL 2
+#endif
+#define DZEILE_PWM (DZEILE_SOLL+1)
+// Beschleunigung unter dem Tastverhaeltnis, nur wenn die Zeile noch frei ist
+// (mit grossen Ziffern der Hoehe 3 geht sie nur ueber die Telemetrie)
+#define DZEILE_BESCHL (DZEILE_PWM+1)
+#if defined(TACHO_ESTIM) && (DZEILE_BESCHL < DISP_NOKIA_LINES)
+#define DETAIL_BESCHL
+// Eigene Feldtabelle je Instanz, die ID der Stack-Anzeige ist auf der Detailseite frei
+#define FELD_BESCHL FELD_STACK
+#endif
+
+// Die Steuerleitungen des Nokia duerfen keinen Eingang an PORTD belegen,
+// init schaltet RST und CD auf Ausgang (nur pruefbar, solange beide auf PORTD liegen)
+#ifdef NOKIA_CONTROL_PORTD
+#define NOKIA_PINS ((1<<NOKIA_RST_BIT)|(1<<NOKIA_CD_BIT))
+#if !defined(TACHO) && (NOKIA_PINS & (1<<PD7))
+#error "NOKIA_RST_BIT/NOKIA_CD_BIT liegt auf der Lichtschranke (PD7)"
+#endif
+#if defined(TACHO) && defined(TACHO_PIND) && (NOKIA_PINS & (TACHO_MASK))
+#error "NOKIA_RST_BIT/NOKIA_CD_BIT liegt auf einer Lichtschranke (TACHO_MASK)"
+#endif
+#if defined(EVENT) && (NOKIA_PINS & (1<<PD6))
+#error "NOKIA_RST_BIT/NOKIA_CD_BIT liegt auf ICP1 (PD6), dem Eingang im EVENT-Betrieb"
+#endif
+#if defined(QUAD) && (NOKIA_PINS & ((1<<PD2)|(1<<PD3)))
+#error "NOKIA_RST_BIT/NOKIA_CD_BIT liegt auf dem Drehgeber (PD2/PD3)"
+#endif
+#endif
+#endif
+
+// Beschleunigung aus der Drehzahlschaetzung, nur wenn sie gesendet oder angezeigt wird
+#if defined(TACHO_ESTIM) && (defined(TELEMETRY) || defined(DETAIL_BESCHL))
+#define BESCHL
+#endif
+
+// Zeilen der Anzeige, mit grossen Ziffern (Nokia, DISP_BIGNUM) steht Ist ab Zeile 1
+// ueber die ganze Breite und belegt DISP_BIG_HEIGHT Zeilen
+#if defined(DISP_NOKIA) && defined(DISP_BIGNUM) && !defined(DISP_MEGACARD)
+#define GROSS_IST 0
+#define ZEILE_SOLL (1+DISP_BIG_HEIGHT)
+#define ZEILE_STACK (2+DISP_BIG_HEIGHT)
+#else
+#define ZEILE_SOLL 1
+#define ZEILE_STACK 2
+#endif
+
+#ifdef SPEED_BAR
+// Drehzahlbalken auf der Seite 0 statt der Soll-Zeile (nur HD44780)
+#ifndef DISP_MEGACARD
+#error "SPEED_BAR braucht das HD44780 (DISP_MEGACARD)"
+#endif
+#define BALKEN_IST 0
+#define BALKEN_VOLL 12000	// Vollausschlag in U/min, wie die max. Drehzahl bei soll
+#endif
+
+// Anzeigeseiten: 0 = Ist/Soll, mit mehreren Lichtschranken folgt pro Kanal eine Seite
+#if defined(TACHO) && (TACHO_CHANNELS > 1)
+#define SEITEN (TACHO_CHANNELS+1)
+#else
+#define SEITEN 1
+#endif
+#define SEITE_TICKS (3*MESS_TICK_HZ)		// 3s pro Seite
+#define SEITE_WERTE_TICKS (MESS_TICK_HZ/5)	// Werte der Kanalseiten alle 0.2s neu ausgeben
+
+#ifdef TACHO_ESTIM
+#if !defined(TACHO)
+#error "TACHO_ESTIM braucht TACHO"
+#endif
+#define SCHAETZ_TICKS (MESS_TICK_HZ/10)		// Schaetzwert alle 0.1s ausgeben
+#endif
+
+#ifdef DISP_MULTI
+// Jede Anzeige ist eine eigene Instanz mit Anzeigespeicher, die display_ Aufrufe
+// wirken auf die mit display_Select ausgewaehlte (sonst immer die Hauptanzeige)
+static display_t haupt;
+static uint8_t hauptpuffer[DISP_BUF_LEN(HAUPT_ZEILEN, HAUPT_SPALTEN)];
+#ifdef DETAIL
+static display_t detail;
+static uint8_t detailpuffer[DISP_BUF_LEN(DISP_NOKIA_LINES, DISP_NOKIA_COLS)];
+#endif
+#endif
+
 
 
 
@@ -36,10 +207,27 @@ void pwmsignal()
 	TCCR0 |= (1<<WGM01) | (1<<WGM00) | (1<<COM01)| (1<<CS02);
 	DDRB|=(1<<PB3);
 	MotorOCR = 23437;
+#ifdef SOFTSTART
+	// Von 0 aus ueber die S-Kurve anfahren statt in einem Schritt
+	OCR0 = 0;
+	softstart_Start(MotorOCR);
+#else
 	OCR0 = MotorOCR;
+#endif
 	 
 }
 
+// Tastverhaeltnis setzen, mit SOFTSTART ueber die Rampe
+void pwm_Setzen(uint8_t wert)
+{
+#ifdef SOFTSTART
+	softstart_Start(wert);
+#else
+	OCR0 = wert;
+#endif
+	TRACE_PUT(TRACE_PWM, wert);
+}
+
 
 void timer1_init()
 {
@@ -49,7 +237,15 @@ void timer1_init()
 	TCCR1B |=(1<<CS11);
 	TIMSK|=(1<<OCIE1B);
 	
-	OCR1B = 150-1; //0.1ms abtastfrequenz 
+	OCR1B = MESS_TICK_TOP-1; //0.1ms abtastfrequenz (MESS_TICK_HZ)
+	
+#ifdef EVENT
+	// Lichtschranke an ICP1 (PD6): steigende Flanke, Zeitstempel per Hardware, Stoerfilter ein
+	DDRD &= ~(1 << PD6);
+	TCCR1B |= (1<<ICNC1) | (1<<ICES1);
+	TIFR = (1<<ICF1);
+	TIMSK |= (1<<TICIE1);
+#endif
 		
 }
 
@@ -57,15 +253,65 @@ void timer1_init()
 //Polling ISR
 ISR(TIMER1_COMPB_vect)
 {
+	// Latenz = Ticks seit dem Compare-Zeitpunkt
+	ISRPROF_ENTER(ISRPROF_CH_TIMER1, TCNT1 - OCR1B);
 	
 	
+	// Zaehler bleiben am Endwert stehen statt ueberzulaufen
+	if (count < 0xFFFF)
+	{
+		count++;
+	}
+	if (stilltick < MESS_STALL_TICKS)
+	{
+		stilltick++;
+	}
+	else
+	{
+		stillstand = 1;
+	}
+	systick++;
+#ifdef SOFTSTART
+	// Naechste Stufe der Anlauframpe, ein Tabellenzugriff
+	softstart_Tick();
+#endif
 	
-	count++;
+	ISRPROF_EXIT(ISRPROF_CH_TIMER1);
 	
+	// Naechster Compare in MESS_TICK_TOP Ticks, TCNT1 laeuft frei und dient als Zeitstempel der Impulse
+	OCR1B += MESS_TICK_TOP;
+}
+
+#ifdef EVENT
+// Flanke der Lichtschranke: nur den Zeitstempel sichern
+ISR(TIMER1_CAPT_vect)
+{
+	// Latenz = Ticks seit der Flanke (ICR1 haelt den Zeitpunkt fest)
+	ISRPROF_ENTER(ISRPROF_CH_CAPT, TCNT1 - ICR1);
+	uint8_t k = erfassung_kopf;
 	
+	if ((uint8_t)(k - erfassung_schwanz) < ERFASSUNG_N)
+	{
+		erfassung[k & (ERFASSUNG_N-1)] = ICR1;
+		erfassung_kopf = k + 1;
+		TRACE_PUT(TRACE_EDGE, (TCCR1B & (1<<ICES1)) ? 1 : 0);
+#ifdef SLOTMON
+		// Beide Flanken: nach jedem Eintrag die andere Flanke erfassen, die Eintraege wechseln
+		// sich damit ab (gerade = steigend). Das Umschalten kann ICF1 setzen, daher loeschen.
+		TCCR1B ^= (1<<ICES1);
+		TIFR = (1<<ICF1);
+#endif
+	}
+	else
+	{
+		erfassung_verloren++;
+		TRACE_PUT(TRACE_OVERRUN, TRACE_OVR_CAPTURE);
+		TRACE_TRIGGER(TRACE_WHY_CAPTURE);
+	}
 	
-	TCNT1 = 0;
+	ISRPROF_EXIT(ISRPROF_CH_CAPT);
 }
+#endif
 
 //MotorPWM
 ISR(TIMER0_COMP_vect)
@@ -90,17 +336,152 @@ void display_UintToDisplay(uint32_t x, char N);
 void display_Home(void);
 
 
+// Tick-Zaehler atomar lesen (16 Bit, wird in der ISR veraendert)
+uint16_t systick_Get(void)
+{
+	uint16_t t;
+	
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		t = systick;
+	}
+	return t;
+}
 
+// Geaenderte Zeichen der ausgewaehlten Anzeige uebertragen (DISP_BACKBUFFER), anzeige: 0 Haupt, 1 Detail
+// Der Flugschreiber verzeichnet nur Durchgaenge, die wirklich etwas gesendet haben
+void anzeige_Commit(uint8_t anzeige)
+{
+#ifdef TRACE
+	uint16_t tick, zeit;
+	
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		tick = systick;
+		zeit = TCNT1;
+	}
+	if (display_Commit())
+	{
+		trace_PutAt(TRACE_DISP_START, anzeige, tick, zeit);
+		TRACE_PUT(TRACE_DISP_END, anzeige);
+	}
+#else
+	(void)anzeige;
+	display_Commit();
+#endif
+}
+
+#ifdef TELEMETRY
+// Init-Zeiten der ausgewaehlten Anzeige ab Schritt erster senden (ein Rahmen)
+// Rueckgabe: naechster zu sendender Schritt, unveraendert wenn der Sendepuffer voll war
+uint8_t initzeit_Senden(uint8_t anzeige, uint8_t erster)
+{
+	telframe_boot_t b;
+	uint8_t i;
+	
+	b.Disp = anzeige;
+	b.First = erster;
+	b.TickUs = (uint16_t)DISP_TICK_US;
+	for (i = 0; i < TELFRAME_BOOT_STAGES; i++)
+	{
+		b.Time[i] = display_InitStageTime(erster + i);
+	}
+	if (!telemetry_Boot(&b))
+	{
+		return erster;
+	}
+	return erster + TELFRAME_BOOT_STAGES;
+}
+#endif
+
+
+// Anzeigeseite aufbauen: Beschriftung einmal ausgeben, danach werden nur noch die Felder aktualisiert
+void seite_Zeichnen(uint8_t seite, int soll)
+{
+	display_Clear();
+	
+	if (seite == 0)
+	{
+		display_Pos(0,0);
+#if defined(QUAD) && !defined(GROSS_IST)
+		// Rueckwaerts braucht "-12000" 6 Stellen, die Beschriftung wird wie bei "Soll" gekuerzt
+		display_TxtToDisplay("Ist", 2);
+#else
+		display_TxtToDisplay("Ist", 3);
+#endif
+#if defined(GROSS_IST) && defined(QUAD)
+		display_BigDefine(GROSS_IST, 0, 1, HAUPT_SPALTEN/DISP_BIG_WIDTH, DISP_FMT_INT);
+#elif defined(GROSS_IST)
+		display_BigDefine(GROSS_IST, 0, 1, HAUPT_SPALTEN/DISP_BIG_WIDTH, DISP_FMT_UINT);
+#elif defined(QUAD)
+		// Mit Drehrichtung: rueckwaerts wird negativ angezeigt
+		display_FieldDefine(FELD_IST, 2, 0, 6, DISP_FMT_INT);
+#else
+		display_FieldDefine(FELD_IST, 3, 0, 5, DISP_FMT_UINT);
+#endif
+#ifdef SPEED_BAR
+		display_BarDefine(BALKEN_IST, 0, 1, HAUPT_SPALTEN);
+#else
+		display_Pos(0,ZEILE_SOLL);
+		display_TxtToDisplay("Soll", 2);
+		display_FieldDefine(FELD_SOLL, 2, ZEILE_SOLL, 6, DISP_FMT_UINT);
+		display_FieldSet(FELD_SOLL, soll);
+#endif
+	}
+	else
+	{
+		// Kanalseite: Drehzahl und Abtastrate (alle Kanaele werden gleich oft gelesen)
+		display_Pos(0,0);
+		display_Printf("K%u", seite);
+		display_FieldDefine(FELD_IST, 3, 0, 5, DISP_FMT_UINT);
+		display_Pos(0,1);
+		display_TxtToDisplay("Hz", 2);
+		display_FieldDefine(FELD_SOLL, 2, 1, 6, DISP_FMT_UINT);
+	}
+	
+#if defined(STACKMON) && (HAUPT_ZEILEN > 2)
+	// Reserve zwischen Stack und .bss (kleinster gemessener Wert)
+	display_Pos(0,ZEILE_STACK);
+	display_TxtToDisplay("Stk", 3);
+	display_FieldDefine(FELD_STACK, 3, ZEILE_STACK, 5, DISP_FMT_UINT);
+#endif
+}
+
+#ifdef DETAIL
+// Detailseite auf dem Nokia: Ist (mit DISP_BIGNUM gross), Soll und Tastverhaeltnis
+// Wird auf der ausgewaehlten Instanz gezeichnet, der Aufrufer waehlt detail aus
+void detail_Zeichnen(int soll)
+{
+	display_Clear();
+	display_Pos(0,0);
+	display_TxtToDisplay("Ist U/min", 9);
+#ifdef DISP_BIGNUM
+	display_BigDefine(FELD_IST, 0, 1, DISP_NOKIA_COLS/DISP_BIG_WIDTH, DISP_FMT_UINT);
+#else
+	display_FieldDefine(FELD_IST, 0, 1, DISP_NOKIA_COLS, DISP_FMT_UINT);
+#endif
+	display_Pos(0,DZEILE_SOLL);
+	display_TxtToDisplay("Soll", 4);
+	display_FieldDefine(FELD_SOLL, 4, DZEILE_SOLL, 5, DISP_FMT_UINT);
+	display_FieldSet(FELD_SOLL, soll);
+	display_Pos(0,DZEILE_PWM);
+	display_TxtToDisplay("PWM", 3);
+	display_FieldDefine(FELD_PWM, 4, DZEILE_PWM, 5, DISP_FMT_UINT);
+#ifdef DETAIL_BESCHL
+	// U/min pro Sekunde
+	display_Pos(0,DZEILE_BESCHL);
+	display_TxtToDisplay("a", 1);
+	display_FieldDefine(FELD_BESCHL, 2, DZEILE_BESCHL, 7, DISP_FMT_INT);
+#endif
+}
+#endif
 
 
 int main(void)
 {
 	
-	int soll;
-	soll = round(12000.0 * (MotorOCR/46874.0));	//12000 = max rpm, MotorOCR/46874 um den Dutycycle zu berechnen
-	//berechnung soll funktioniert nicht, Grund unbekannt
-	//MotorOCR wird deswegen verwendet, da OCR0 nicht als die eingegebene Zahl abgespeichert wird, sondern als restwert von "(Eingegebener Wert/256)"
-	//also wird OCR0 bei 23437 als 141 abgespeichert (91*256+141 = 23437)
+	// Sollwert in U/min, beim Uebersetzen einstellbar (MOTOR_SOLL_RPM)
+	int soll = MOTOR_SOLL_RPM;
 	
 	
 	DDRD &= ~(1 << PD7);
@@ -110,43 +491,328 @@ int main(void)
 	
 	cli();
 	
+	// Messung und Motor-PWM laufen sofort, das Display wird im Hintergrund initialisiert
+#ifdef ISRPROF
+	isrprof_Init();
+#endif
+#ifdef TRACE
+	trace_Init();
+#endif
+#ifdef TELEMETRY
+	telemetry_Init();
+	uint8_t statuszaehler = 0;
+#ifdef ISRPROF
+	uint8_t isrkanal = 0;
+#endif
+	// Naechster zu sendender Init-Schritt je Anzeige, ab DISP_INIT_STAGES ist alles gesendet
+	uint8_t initschritt = 0;
+#ifdef DETAIL
+	uint8_t detailschritt = 0;
+#endif
+#endif
+#ifdef EELOG
+	// Logbuch-Ende suchen, leeres EEPROM wird im Hintergrund formatiert
+	eelog_Init();
+#endif
+#ifdef TACHO
+	tacho_InitAll();
+#endif
+#ifdef VIBRA
+	vibra_Reset();
+	uint8_t vibraneu = 0;
+#endif
+#ifdef SLOTMON
+	slotmon_Reset();
+#ifdef TELEMETRY
+	uint8_t schlitz = 0;
+#endif
+#endif
+#if defined(TRACE) && defined(TACHO)
+	uint16_t verworfen = 0;
+#endif
+#if defined(TRACE) && defined(TELEMETRY)
+	uint8_t spurix = 0;
+#endif
+#ifdef TACHO_ESTIM
+	uint16_t schaetzzeit = 0;
+#endif
+#ifdef BESCHL
+	// Beschleunigung in U/min pro Sekunde, pro Block aus der Schaetzung
+	int16_t beschl = 0;
+#endif
+#ifdef EVENT
+	power_Init();
+#endif
+#ifdef QUAD
+	// Zweite Lichtschranke fuer die Drehrichtung an PD2/PD3
+	quad_Init();
+#endif
 	timer1_init();	
-	display_Init();
-	display_Clear();
 	
+#if !defined(TACHO)
+	// Letzter Pegel an PD7 fuer die Flankenerkennung im Polling
 	int last = 0;
+#endif
 	int ausgabe;
+	uint8_t dispbereit = 0;
+#ifdef DETAIL
+	uint8_t detailbereit = 0;
+#endif
+	uint8_t impuls;
+	uint8_t seite = 0;
+	uint8_t stillgemeldet = 0;
+#ifdef SOFTSTART
+	uint8_t rampe = 1;
+#endif
+#if !defined(TACHO) || defined(TELEMETRY)
+	// Ticks pro Block, mit TACHO nur noch fuer die Telemetrie
+	uint16_t zaehler;
+#endif
+	uint8_t anzeigen = 0;
+	uint8_t faellig = 1;
+#ifdef EVENT
+	uint16_t jetzt;
+	uint16_t tickgesehen = 0;
+#endif
+#if SEITEN > 1
+	uint16_t seitezeit = 0;
+	uint8_t seitezaehler = 0;
+#endif
 	pwmsignal();
 	
 	sei();
 	
+#ifdef DISP_MULTI
+#ifdef DETAIL
+	display_Create(&detail, &display_OpsNokia, detailpuffer);
+	display_Select(&detail);
+	display_InitStart(systick_Get());
+#endif
+	display_Create(&haupt, &HAUPT_OPS, hauptpuffer);
+	display_Select(&haupt);
+#endif
+	display_InitStart(systick_Get());
+	
+#ifdef MOTORCAL
+	// Ohne gespeicherte Kennlinie zuerst kalibrieren, sonst direkt vorsteuern
+	uint8_t kalibrierung = 0;
+	if (motorcal_Init())
+	{
+		pwm_Setzen(motorcal_Duty(soll));
+	}
+	else
+	{
+#ifdef SOFTSTART
+		// Die Kalibrierung stellt OCR0 selbst
+		softstart_Stop();
+#endif
+		motorcal_Start(systick_Get());
+		kalibrierung = 1;
+	}
+#endif
+	
 	while (1)
 	{
+#ifdef EVENT
+		// Ablaufsteuerung (Display, Motor, Statistik) nur einmal pro Tick, Flanken sofort
+		jetzt = systick_Get();
+#ifdef TRACE
+		// Mehr als ein Tick seit dem letzten Durchlauf: die Hauptschleife kommt nicht nach
+		if ((uint16_t)(jetzt - tickgesehen) > 1)
+		{
+			TRACE_PUT(TRACE_OVERRUN, TRACE_OVR_TICK);
+		}
+#endif
+		faellig = (jetzt != tickgesehen);
+		tickgesehen = jetzt;
+		if (faellig)
+		{
+			tacho_Check(jetzt);
+#ifdef TELEMETRY
+			if (power_Tick(jetzt))
+			{
+				telemetry_Power(power_Wakes(), power_SleepPermille());
+			}
+#else
+			power_Tick(jetzt);
+#endif
+		}
+#endif
+		
+		// Display-Initialisierung, ein Schritt pro Durchlauf sobald faellig
+		if (faellig && !dispbereit && display_InitTask(systick_Get()))
+		{
+			dispbereit = 1;
+			seite_Zeichnen(0, soll);
+#if SEITEN > 1
+			seitezeit = systick_Get();
+#endif
+		}
+		
+#ifdef DETAIL
+		// Detailanzeige unabhaengig initialisieren, danach wieder die Hauptanzeige auswaehlen
+		if (faellig && !detailbereit)
+		{
+			display_Select(&detail);
+			if (display_InitTask(systick_Get()))
+			{
+				detailbereit = 1;
+				detail_Zeichnen(soll);
+			}
+			display_Select(&haupt);
+		}
+#endif
+		
+#ifdef TELEMETRY
+		// Boot-Zeit: die Init-Zeiten jeder Anzeige einmal senden, sobald sie bereit ist
+		if (faellig && dispbereit && (initschritt < DISP_INIT_STAGES))
+		{
+			initschritt = initzeit_Senden(0, initschritt);
+		}
+#ifdef DETAIL
+		if (faellig && detailbereit && (detailschritt < DISP_INIT_STAGES))
+		{
+			display_Select(&detail);
+			detailschritt = initzeit_Senden(1, detailschritt);
+			display_Select(&haupt);
+		}
+#endif
+#endif
 		
+#ifdef TACHO_ESTIM
+		// Zwischen den Bloecken die auf jetzt fortgeschriebene Drehzahl ausgeben,
+		// bei Rampen laeuft die Anzeige damit nicht um ein Messfenster hinterher
+		if (faellig && ((uint16_t)(systick_Get() - schaetzzeit) >= SCHAETZ_TICKS))
+		{
+			schaetzzeit = systick_Get();
+			drehzahl = tacho_RpmNow(&tacho_Ch[0], tacho_Stamp(), schaetzzeit);
+			anzeigen = 1;
+		}
+#endif
+		
+#if SEITEN > 1
+		// Seiten der Reihe nach anzeigen, auf den Kanalseiten die Werte zyklisch ausgeben
+		if (faellig && dispbereit && ((uint16_t)(systick_Get() - seitezeit) >= SEITE_WERTE_TICKS))
+		{
+			seitezeit += SEITE_WERTE_TICKS;
+			if (++seitezaehler >= SEITE_TICKS/SEITE_WERTE_TICKS)
+			{
+				seitezaehler = 0;
+				seite = (seite + 1) % SEITEN;
+				seite_Zeichnen(seite, soll);
+			}
+			if (seite > 0)
+			{
+				display_FieldSet(FELD_IST, tacho_Rpm(&tacho_Ch[seite-1]));
+				display_FieldSet(FELD_SOLL, tacho_ScanRate());
+			}
+		}
+#endif
+	
+#ifdef MOTORCAL
+		// Nach der Kalibrierung das Tastverhaeltnis aus der Kennlinie setzen (mit SOFTSTART als Rampe)
+		if (faellig && !motorcal_Task(systick_Get()) && kalibrierung)
+		{
+			kalibrierung = 0;
+			pwm_Setzen(motorcal_Duty(soll));
+		}
+#endif
 	
+#ifdef SOFTSTART
+		// Rampe beendet: ein waehrenddessen gemeldeter Stillstand wird mit dem Endwert neu bewertet
+		if (rampe && !softstart_Active())
+		{
+			stillgemeldet = 0;
+		}
+		rampe = softstart_Active();
+#endif
+		
+		// Stillstand: seit MESS_STALL_MS kein Impuls, 0 U/min melden statt den letzten Wert stehen zu lassen
+		if (stillstand && !stillgemeldet)
+		{
+			stillgemeldet = 1;
+			drehzahl = 0;
+			anzeigen = 1;
+#ifdef SOFTSTART
+			// Waehrend der Rampe ist ein Stillstand bei kleinem Tastverhaeltnis erwartet,
+			// bewertet wird erst am Ende der Rampe (siehe unten)
+			blockiert = (OCR0 != 0) && !softstart_Active();
+#else
+			blockiert = (OCR0 != 0);
+#endif
+			TRACE_PUT(TRACE_STALL, blockiert);
+#ifdef TRACE
+			if (blockiert)
+			{
+				TRACE_TRIGGER(TRACE_WHY_STALL);
+			}
+#endif
+#ifdef VIBRA
+			// Die Pause gehoert nicht zur Periodenfolge, nach dem Anlauf neuer Block
+			vibra_Reset();
+#endif
+#ifdef SLOTMON
+			// Ohne Indexmarke ist die Zuordnung der Schlitze nach dem Anlauf eine andere
+			slotmon_Restart();
+#endif
+			
+#ifdef BESCHL
+			beschl = 0;
+#endif
+#ifdef TELEMETRY
+			telemetry_Mess(0, 0xFFFF, soll, OCR0, 0);
+#endif
+#ifdef MOTORCAL
+			motorcal_Sample(0);
+#endif
+#ifdef STALL_STOP
+			// Motor bei Blockade abschalten, bleibt aus bis zum naechsten Reset
+#ifdef MOTORCAL
+			// Waehrend der Kalibrierung sind Stillstaende bei kleinem Tastverhaeltnis erwartet
+			if (blockiert && !kalibrierung)
+#else
+			if (blockiert)
+#endif
+			{
+#ifdef SOFTSTART
+				softstart_Stop();
+#endif
+				OCR0 = 0;
+				TRACE_PUT(TRACE_PWM, 0);
+			}
+#endif
+		}
+		
+#if defined(EVENT)
+		// Eine erfasste Flanke pro Durchlauf, der Zeitstempel stammt aus ICR1
+		impuls = 0;
+		if (erfassung_schwanz != erfassung_kopf)
+		{
+#ifdef SLOTMON
+			// Gerade Eintraege sind steigende Flanken, nur diese zaehlen fuer die Drehzahl
+			uint16_t flanke = erfassung[erfassung_schwanz & (ERFASSUNG_N-1)];
+			slotmon_Edge(!(erfassung_schwanz & 1), flanke, systick_Get());
+			if (!(erfassung_schwanz & 1))
+			{
+				impuls = tacho_Edge(&tacho_Ch[0], flanke, systick_Get());
+			}
+#else
+			impuls = tacho_Edge(&tacho_Ch[0], erfassung[erfassung_schwanz & (ERFASSUNG_N-1)], systick_Get());
+#endif
+			erfassung_schwanz++;
+		}
+#elif defined(TACHO)
+		// Alle Lichtschranken mit einem Lesezugriff, Kanal 0 liefert wie bisher die Bloecke
+		impuls = tacho_Scan(systick_Get()) & 1;
+#else
+		// Steigende Flanke an PD7
+		impuls = 0;
 		if((PIND&(1<<7)))
 		{
-			
 			if(last == 0)
 			{
-				save++;
-				lichtschranke++;
-				if(lichtschranke >=100)
-				{
-					lichtschranke  =0; 
-					drehzahl = round((25.0/count)*10000*60);
-					//ausgabe = (int)(drehzahl + 0.5d);
-					
-					display_Home();
-					display_TxtToDisplay("Ist", 3);
-					display_UintToDisplay(drehzahl, 5);
-					
-					display_TxtToDisplay("Soll", 2);
-					display_UintToDisplay(soll, 6);
-					count = 0;
-				}
+				impuls = 1;
 			}
-			
 			last = 1;
 			
 			
@@ -157,6 +823,272 @@ int main(void)
 			last = 0;
 			//PORTC &= ~(1<<PC5);
 		}
+#endif
+		
+		if (impuls)
+		{
+			// Stillstands-Zeitgeber neu starten
+			ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+			{
+				stilltick = 0;
+				stillstand = 0;
+			}
+#ifndef EVENT
+			// Im EVENT-Betrieb traegt die Capture-ISR die Flanke ein
+			TRACE_PUT(TRACE_EDGE, 1);
+#endif
+			if (stillgemeldet)
+			{
+				// Nach einem Stillstand mit einem neuen Block beginnen, die Pause gehoert nicht zur Messung
+				stillgemeldet = 0;
+				blockiert = 0;
+				lichtschranke = 0;
+				ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+				{
+					count = 0;
+				}
+			}
+#ifdef TACHO
+			// Neue Drehzahl nach jedem Impuls, der Block unten bestimmt nur noch die Ausgaberate
+#ifdef TACHO_ESTIM
+			drehzahl = tacho_RpmEst(&tacho_Ch[0]);
+#else
+			drehzahl = tacho_Rpm(&tacho_Ch[0]);
+#endif
+#ifdef TRACE
+			// Ausreisser oder Prellen in der Periodenmessung loesen den Flugschreiber aus
+			if (tacho_Ch[0].Rejected != verworfen)
+			{
+				verworfen = tacho_Ch[0].Rejected;
+				TRACE_TRIGGER(TRACE_WHY_OUTLIER);
+			}
+#endif
+#endif
+#ifdef VIBRA
+			// Jede Periode in die Schwingungsanalyse, pro Impuls nur die Filterschritte
+			if (vibra_Sample(tacho_RawPeriod(&tacho_Ch[0])))
+			{
+				vibraneu = 1;
+			}
+#endif
+			save++;
+			lichtschranke++;
+			if(lichtschranke >=MESS_BLOCK)
+			{
+				lichtschranke  =0; 
+				TRACE_PUT(TRACE_BLOCK, (drehzahl >= 25500) ? 255 : drehzahl / 100);
+				
+#if !defined(TACHO) || defined(TELEMETRY)
+				// Ticks des Blocks lesen und neu beginnen (16 Bit, wird im Interrupt veraendert)
+				ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+				{
+					zaehler = count;
+					count = 0;
+				}
+#endif
+#ifndef TACHO
+				// Konstanten sind beim Uebersetzen zu einem Faktor zusammengefasst (messcfg.h)
+				// Ein gesaettigter Zaehler (0xFFFF) ergibt eine Obergrenze der Drehzahl
+				if (zaehler > 0)
+				{
+					drehzahl = (MESS_K_BLOCK + zaehler/2) / zaehler;
+				}
+#endif
+				//ausgabe = (int)(drehzahl + 0.5d);
+				
+				anzeigen = 1;
+#ifdef BESCHL
+				{
+					// Auf 16 Bit begrenzen, mehr als 32767 U/min pro Sekunde kommt praktisch nicht vor
+					int32_t a = tacho_Accel(&tacho_Ch[0]);
+					beschl = (a > 32767) ? 32767 : (a < -32767) ? -32767 : (int16_t)a;
+				}
+#endif
+				
+#ifdef TELEMETRY
+				// Messwert senden, blockiert nicht (volle Puffer werden verworfen)
+#ifdef BESCHL
+				telemetry_Mess(drehzahl, zaehler, soll, OCR0, beschl);
+#else
+				telemetry_Mess(drehzahl, zaehler, soll, OCR0, 0);
+#endif
+				if (++statuszaehler >= 16)
+				{
+					statuszaehler = 0;
+#ifdef STACKMON
+					telemetry_Status(stackmon_MinUnused());
+#else
+					telemetry_Status(0xFFFF);
+#endif
+#ifdef ISRPROF
+					// Worst-Case der ISRs, pro Status ein Kanal reihum (der Sendepuffer ist klein)
+					isrprof_stat_t profil;
+					isrprof_Get(isrkanal, &profil);
+					telemetry_Isr(isrkanal, profil.Cnt, profil.LatMax, profil.ExeMax, profil.Over, ISRPROF_BUDGET);
+					if (++isrkanal >= ISRPROF_CHANNELS)
+					{
+						isrkanal = 0;
+					}
+#endif
+				}
+#ifdef QUAD
+				// Position und verlorene Flanken des Drehgebers
+				telemetry_Quad(quad_Position(), quad_Errors(), QUAD_STEPS_PER_REV, quad_Direction());
+#endif
+#ifdef SLOTMON
+				// Pro Block ein Schlitz, reihum
+				telemetry_Slot(schlitz, slotmon_Flags(), slotmon_Duty(schlitz), slotmon_Min(schlitz), slotmon_Max(schlitz), slotmon_Glitches());
+				if (++schlitz >= MESS_PPR)
+				{
+					schlitz = 0;
+				}
+#endif
+#endif
+				
+#ifdef MOTORCAL
+				motorcal_Sample(drehzahl);
+#endif
+				
+#ifdef EELOG
+				// Jede EELOG_DIVIDER-te Messung ins EEPROM, Schreiben laeuft per Interrupt
+				eelog_Put(drehzahl);
+#endif
+				
+#ifdef STACKMON
+				// Reserve nach jeder Messung und Display-Aenderung pruefen
+				stackmon_Check();
+#endif
+			}
+		}
+		
+#ifdef DETAIL
+		// Vor der Hauptanzeige, die loescht anzeigen
+		if (anzeigen && faellig && detailbereit)
+		{
+			display_Select(&detail);
+#ifndef DISP_BACKBUFFER
+			TRACE_PUT(TRACE_DISP_START, 1);
+#endif
+#ifdef DISP_BIGNUM
+			display_BigSet(FELD_IST, drehzahl);
+#else
+			display_FieldSet(FELD_IST, drehzahl);
+#endif
+			display_FieldSet(FELD_PWM, OCR0);
+#ifdef DETAIL_BESCHL
+			display_FieldSet(FELD_BESCHL, beschl);
+#endif
+#ifndef DISP_BACKBUFFER
+			TRACE_PUT(TRACE_DISP_END, 1);
+#endif
+			display_Select(&haupt);
+		}
+#endif
+		
+		// Anzeige nachfuehren, im EVENT-Betrieb im Tick-Raster
+		if (anzeigen && faellig && dispbereit)
+		{
+			anzeigen = 0;
+#ifndef DISP_BACKBUFFER
+			// Ohne Back-Buffer schreiben die Felder direkt auf das Display
+			TRACE_PUT(TRACE_DISP_START, 0);
+#endif
+			if (seite == 0)
+			{
+#if defined(GROSS_IST) && defined(QUAD)
+				display_BigSet(GROSS_IST, (quad_Direction() < 0) ? -(int32_t)drehzahl : drehzahl);
+#elif defined(GROSS_IST)
+				display_BigSet(GROSS_IST, drehzahl);
+#elif defined(QUAD)
+				display_FieldSet(FELD_IST, (quad_Direction() < 0) ? -(int32_t)drehzahl : drehzahl);
+#else
+				display_FieldSet(FELD_IST, drehzahl);
+#endif
+#ifdef SPEED_BAR
+				display_BarSet(BALKEN_IST, drehzahl, BALKEN_VOLL);
+#endif
+			}
+#if defined(STACKMON) && (HAUPT_ZEILEN > 2)
+			display_FieldSet(FELD_STACK, stackmon_MinUnused());
+#endif
+#ifndef DISP_BACKBUFFER
+			TRACE_PUT(TRACE_DISP_END, 0);
+#endif
+		}
+		
+#ifdef VIBRA
+		// Amplitude und Phase (Wurzel, Winkel) erst hier berechnen, nicht im Impulspfad
+		if (vibraneu && faellig)
+		{
+			vibraneu = 0;
+#ifdef TELEMETRY
+			uint8_t f;
+			for (f = 0; f < VIBRA_FILTERS; f++)
+			{
+				if (vibra_Harm(f))
+				{
+					telemetry_Vibra(vibra_Harm(f), vibra_Amp(f), vibra_Phase(f), vibra_Mean());
+				}
+			}
+#endif
+		}
+#endif
+		
+		// Mit DISP_BACKBUFFER gehen erst hier die geaenderten Zeichen zum Display,
+		// ein Seitenwechsel wird so in einem Durchgang ohne Zwischenstand uebertragen
+		if (faellig && dispbereit)
+		{
+			anzeige_Commit(0);
+		}
+#ifdef DETAIL
+		if (faellig && detailbereit)
+		{
+			display_Select(&detail);
+			anzeige_Commit(1);
+			display_Select(&haupt);
+		}
+#endif
+		
+#if defined(TRACE) && defined(TELEMETRY)
+		// Eingefrorenen Flugschreiber stueckweise senden (aeltestes Ereignis zuerst), danach neu scharf schalten
+		if (faellig && trace_Frozen())
+		{
+			telframe_trace_t spur;
+			trace_rec_t r;
+			uint8_t e;
+			
+			spur.First = spurix;
+			spur.Total = TRACE_N;
+			spur.TickTop = MESS_TICK_TOP;
+			for (e = 0; e < TELFRAME_TRACE_EVENTS; e++)
+			{
+				trace_Get(spurix + e, &r);
+				spur.Ev[e].Id = r.Id;
+				spur.Ev[e].Arg = r.Arg;
+				spur.Ev[e].Tick = r.Tick;
+				spur.Ev[e].Time = r.Time;
+			}
+			if (telemetry_Trace(&spur))
+			{
+				spurix += TELFRAME_TRACE_EVENTS;
+				if (spurix >= TRACE_N)
+				{
+					spurix = 0;
+					trace_Init();
+				}
+			}
+		}
+#endif
+		
+#ifdef EVENT
+		// Nichts mehr zu tun: schlafen bis zum naechsten Interrupt (Tick, Flanke, USART, EEPROM)
+		cli();
+		if ((erfassung_schwanz == erfassung_kopf) && (systick == tickgesehen))
+		{
+			power_Sleep();
+		}
+		sei();
+#endif
 	}
 		
 }
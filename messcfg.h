@@ -0,0 +1,91 @@
+/************************************************************/
+/* Konfiguration der Drehzahlmessung						*/
+/*															*/
+/* Alle Grssen, die von der Hardware abhngen (Geberscheibe,	*/
+/* Getriebe, Timertakt, Blocklnge), stehen hier. Daraus	*/
+/* werden beim bersetzen ganzzahlige Konstanten gebildet,	*/
+/* zur Laufzeit bleibt pro Messwert eine einzige Division:	*/
+/*   Drehzahl = MESS_K_BLOCK / count						*/
+/*   Drehzahl = MESS_K_PERIOD / Periode						*/
+/* Alle Werte knnen als Symbole im Projekt berschrieben	*/
+/* werden und werden beim bersetzen geprft.				*/
+/************************************************************/
+
+#ifndef MESSCFG_H
+#define MESSCFG_H
+
+#include <stdint.h>
+
+// Impulse (Schlitze) pro Umdrehung der Geberscheibe
+#ifndef MESS_PPR
+#define MESS_PPR 4
+#endif
+
+// bersetzung Geberwelle -> angezeigte Welle als Bruch (Zhler/Nenner)
+// Beispiel: Geber auf der Motorwelle, Anzeige der Abtriebswelle bei 5:1 -> 1/5
+#ifndef MESS_GEAR_NUM
+#define MESS_GEAR_NUM 1
+#endif
+#ifndef MESS_GEAR_DEN
+#define MESS_GEAR_DEN 1
+#endif
+
+// Takt von Timer1 (Vorteiler 8) und Frequenz des Abtast-Ticks (systick, count)
+#ifndef MESS_TIMER_HZ
+#define MESS_TIMER_HZ (F_CPU/8)
+#endif
+// Im EVENT-Betrieb kommen die Flanken per Input Capture, der Tick dient nur noch der
+// Ablaufsteuerung und weckt die CPU seltener (DISP_TICK_US und MOTORCAL_TICK_US folgen)
+#ifndef MESS_TICK_HZ
+#ifdef EVENT
+#define MESS_TICK_HZ 1000UL
+#else
+#define MESS_TICK_HZ 10000UL
+#endif
+#endif
+
+// Anzahl Impulse pro Block (Ausgaberate und Mittelung der Blockmessung)
+#ifndef MESS_BLOCK
+#define MESS_BLOCK 100
+#endif
+
+// Stillstand: nach so vielen ms ohne Impuls wird 0 U/min gemeldet
+// Die Messung reicht damit hinunter bis 60000 / (MESS_STALL_MS * PPR) U/min der Geberwelle.
+// Mit TACHO werden Perioden ber den berlauf von Timer1 (43.7ms) hinaus mit systick verlngert.
+#ifndef MESS_STALL_MS
+#define MESS_STALL_MS 500
+#endif
+
+// Timer1-Ticks pro Abtast-Tick (Abstand der Compare-Interrupts)
+#define MESS_TICK_TOP (MESS_TIMER_HZ/MESS_TICK_HZ)
+
+// Stillstandszeit in Abtast-Ticks
+#define MESS_STALL_TICKS ((uint16_t)((uint32_t)MESS_STALL_MS*MESS_TICK_HZ/1000))
+
+// Gemeinsamer Nenner der Umrechnung
+#define MESS_DIV ((uint64_t)MESS_PPR*MESS_GEAR_DEN)
+
+// Blockmessung: count Abtast-Ticks fr MESS_BLOCK Impulse
+// U/min = 60 * MESS_TICK_HZ * MESS_BLOCK * Zhler / (PPR * Nenner * count)
+#define MESS_K_BLOCK ((uint32_t)((60ULL*MESS_TICK_HZ*MESS_BLOCK*MESS_GEAR_NUM+MESS_DIV/2)/MESS_DIV))
+
+// Einzelperioden in Timer1-Ticks
+// U/min = 60 * MESS_TIMER_HZ * Zhler / (PPR * Nenner * Periode)
+#define MESS_K_PERIOD ((uint32_t)((60ULL*MESS_TIMER_HZ*MESS_GEAR_NUM+MESS_DIV/2)/MESS_DIV))
+
+// Prfungen beim bersetzen
+#if (MESS_PPR < 1) || (MESS_GEAR_NUM < 1) || (MESS_GEAR_DEN < 1) || (MESS_BLOCK < 1)
+#error "MESS_PPR, MESS_GEAR_NUM, MESS_GEAR_DEN und MESS_BLOCK muessen >= 1 sein"
+#elif (MESS_TIMER_HZ % MESS_TICK_HZ) != 0
+#error "MESS_TIMER_HZ muss ein Vielfaches von MESS_TICK_HZ sein"
+#elif (MESS_TICK_TOP < 50) || (MESS_TICK_TOP > 65535)
+#error "MESS_TICK_TOP ausserhalb 50..65535, Abtast-Tick passt nicht zum Timertakt"
+#elif ((60*MESS_TICK_HZ*MESS_BLOCK*MESS_GEAR_NUM)/(MESS_PPR*MESS_GEAR_DEN)) > 0xFFFFFFFF
+#error "MESS_K_BLOCK passt nicht in 32 Bit"
+#elif ((MESS_STALL_MS*MESS_TICK_HZ)/1000 < 1) || ((MESS_STALL_MS*MESS_TICK_HZ)/1000 > 65534)
+#error "MESS_STALL_MS ergibt weniger als 1 oder mehr als 65534 Abtast-Ticks"
+#elif ((60*MESS_TICK_HZ*MESS_BLOCK*MESS_GEAR_NUM)/(MESS_PPR*MESS_GEAR_DEN)) < 1000
+#error "MESS_K_BLOCK < 1000, die Blockmessung waere zu grob"
+#endif
+
+#endif
@@ -0,0 +1,265 @@
+/************************************************************/
+/* Implementierung von motorcal.h							*/
+/*															*/
+/************************************************************/
+
+#ifdef MOTORCAL
+
+#include <avr/io.h>
+#include <avr/eeprom.h>
+#include "motorcal.h"
+#ifdef EELOG
+#include "eelog.h"
+#endif
+#ifdef TRACE
+#include "trace.h"
+#endif
+
+#define MOTORCAL_MAGIC	0xC3
+
+// Millisekunden in Ticks der bergebenen Zeitbasis
+#define MOTORCAL_TICKS(ms) ((uint16_t)((ms)*1000UL/MOTORCAL_TICK_US))
+
+#if ((MOTORCAL_TIMEOUT_MS)*1000UL/MOTORCAL_TICK_US) > 65535UL
+#error "MOTORCAL_TIMEOUT_MS ist fr einen 16 Bit Tick zu gross"
+#endif
+#if (MOTORCAL_POINTS < 2) || (MOTORCAL_GRID < 2)
+#error "MOTORCAL_POINTS und MOTORCAL_GRID muessen mindestens 2 sein"
+#endif
+
+// Zustnde der Kalibrierung
+#define MOTORCAL_IDLE		0
+#define MOTORCAL_SETTLE		1
+#define MOTORCAL_MEASURE	2
+#define MOTORCAL_SAVE		3
+
+// Umgekehrte Kennlinie: Duty[i] gilt fr i<<Shift U/min
+typedef struct
+{
+	uint8_t Magic;
+	uint8_t Shift;
+	uint8_t Duty[MOTORCAL_GRID];
+	uint8_t Chk;
+} motorcal_tab_t;
+
+#ifdef EELOG
+#if (MOTORCAL_CAL_OFS + MOTORCAL_GRID + 3) > EELOG_CAL_SIZE
+#error "Die Tabelle passt nicht in den Kalibrierbereich von eelog"
+#endif
+#else
+static motorcal_tab_t EEMEM _loc_EeTab;
+#endif
+
+static motorcal_tab_t _loc_Tab;
+static uint8_t _loc_Valid = 0;
+
+// Messwerte pro Stufe, nur whrend der Kalibrierung bentigt
+static uint16_t _loc_Rpm[MOTORCAL_POINTS];
+static uint8_t _loc_State = MOTORCAL_IDLE;
+static uint8_t _loc_Step;
+static uint16_t _loc_T0;
+static uint16_t _loc_Prev;
+static uint8_t _loc_Have;
+static uint8_t _loc_Steady;
+
+// Tastverhltnis der Stufe k
+static uint8_t _loc_StepDuty(uint8_t k)
+{
+	return (uint8_t)(((uint16_t)k*255)/(MOTORCAL_POINTS-1));
+}
+
+static uint8_t _loc_Checksum(const motorcal_tab_t *t)
+{
+	const uint8_t *p=(const uint8_t*)t;
+	uint8_t i, Sum=0;
+	
+	for (i=0;i<sizeof(motorcal_tab_t)-1;i++) Sum+=p[i];
+	return (uint8_t)~Sum;
+}
+
+static void _loc_SetStep(uint8_t k, uint16_t now)
+{
+	_loc_Step=k;
+	OCR0=_loc_StepDuty(k);
+#ifdef TRACE
+	trace_Put(TRACE_PWM,OCR0);
+#endif
+	_loc_T0=now;
+	_loc_State=MOTORCAL_SETTLE;
+}
+
+// Aus den gemessenen Stufen die umgekehrte Kennlinie berechnen
+// Rckgabe: 0 wenn der Motor in keiner Stufe gedreht hat
+static uint8_t _loc_Build(void)
+{
+	uint8_t k, g, Shift = 0;
+	uint16_t Max, Lo, Hi;
+	uint32_t r;
+	
+	// Kennlinie monoton machen, Messrauschen darf die Suche nicht stren
+	for (k=1;k<MOTORCAL_POINTS;k++)
+	{
+		if (_loc_Rpm[k]<_loc_Rpm[k-1]) _loc_Rpm[k]=_loc_Rpm[k-1];
+	}
+	Max=_loc_Rpm[MOTORCAL_POINTS-1];
+	if (Max==0) return 0;
+	
+	// Kleinste Zweierpotenz, mit der das Raster die Maximaldrehzahl abdeckt
+	while (((uint32_t)(MOTORCAL_GRID-1)<<Shift)<Max) Shift++;
+	
+	k=0;
+	for (g=0;g<MOTORCAL_GRID;g++)
+	{
+		r=(uint32_t)g<<Shift;
+		
+		// Erste Stufe, die r erreicht; die Rasterpunkte steigen, daher luft k nur vorwrts
+		while ((k<MOTORCAL_POINTS) && (_loc_Rpm[k]<r)) k++;
+		
+		if (k>=MOTORCAL_POINTS)
+		{
+			_loc_Tab.Duty[g]=255;
+		}
+		else if ((k==0) || (_loc_Rpm[k]==r))
+		{
+			_loc_Tab.Duty[g]=_loc_StepDuty(k);
+		}
+		else
+		{
+			// Lineare Interpolation zwischen Stufe k-1 (< r) und k (> r)
+			Lo=_loc_Rpm[k-1];
+			Hi=_loc_Rpm[k];
+			_loc_Tab.Duty[g]=_loc_StepDuty(k-1)+(uint8_t)(((uint32_t)(_loc_StepDuty(k)-_loc_StepDuty(k-1))*(r-Lo))/(Hi-Lo));
+		}
+	}
+	
+	_loc_Tab.Magic=MOTORCAL_MAGIC;
+	_loc_Tab.Shift=Shift;
+	_loc_Tab.Chk=_loc_Checksum(&_loc_Tab);
+	return 1;
+}
+
+uint8_t motorcal_Init(void)
+{
+#ifdef EELOG
+	eelog_CalRead(MOTORCAL_CAL_OFS,&_loc_Tab,sizeof(_loc_Tab));
+#else
+	eeprom_read_block(&_loc_Tab,&_loc_EeTab,sizeof(_loc_Tab));
+#endif
+	_loc_Valid=(_loc_Tab.Magic==MOTORCAL_MAGIC) && (_loc_Tab.Shift<=12) && (_loc_Tab.Chk==_loc_Checksum(&_loc_Tab));
+	return _loc_Valid;
+}
+
+void motorcal_Start(uint16_t now)
+{
+	_loc_SetStep(0,now);
+}
+
+void motorcal_Sample(uint16_t rpm)
+{
+	uint16_t Diff;
+	
+	if ((_loc_State!=MOTORCAL_MEASURE) || _loc_Steady) return;
+	
+	// Eingeschwungen, wenn zwei aufeinanderfolgende Werte um weniger als 1/32 abweichen
+	if (_loc_Have)
+	{
+		Diff=(rpm>_loc_Prev)?(rpm-_loc_Prev):(_loc_Prev-rpm);
+		if (Diff<=(_loc_Prev>>5))
+		{
+			_loc_Rpm[_loc_Step]=(uint16_t)(((uint32_t)rpm+_loc_Prev)/2);
+			_loc_Steady=1;
+			return;
+		}
+	}
+	_loc_Prev=rpm;
+	_loc_Have=1;
+}
+
+uint8_t motorcal_Task(uint16_t now)
+{
+	switch (_loc_State)
+	{
+		case MOTORCAL_SETTLE:
+			// Messwerte aus der bergangszeit verwerfen
+			if ((uint16_t)(now-_loc_T0)>=MOTORCAL_TICKS(MOTORCAL_SETTLE_MS))
+			{
+				_loc_Have=0;
+				_loc_Steady=0;
+				_loc_State=MOTORCAL_MEASURE;
+			}
+			break;
+		
+		case MOTORCAL_MEASURE:
+			if (!_loc_Steady)
+			{
+				if ((uint16_t)(now-_loc_T0)<MOTORCAL_TICKS(MOTORCAL_TIMEOUT_MS)) break;
+				
+				// Nicht eingeschwungen: letzten Wert nehmen, ohne Messwert steht der Motor
+				_loc_Rpm[_loc_Step]=_loc_Have?_loc_Prev:0;
+			}
+			
+			if (_loc_Step<MOTORCAL_POINTS-1)
+			{
+				_loc_SetStep(_loc_Step+1,now);
+			}
+			else if (_loc_Build())
+			{
+				_loc_Valid=1;
+				_loc_State=MOTORCAL_SAVE;
+			}
+			else
+			{
+				// Motor hat sich nicht gedreht, bisherige Tabelle bleibt gltig
+				_loc_State=MOTORCAL_IDLE;
+			}
+			break;
+		
+		case MOTORCAL_SAVE:
+#ifdef EELOG
+			// Luft gerade ein anderer Block (z.B. Formatieren), spter erneut versuchen
+			if (!eelog_CalWrite(MOTORCAL_CAL_OFS,&_loc_Tab,sizeof(_loc_Tab))) break;
+#else
+			// Blockiert ca. 8.5ms pro gendertem Byte, nur einmal nach der Kalibrierung
+			eeprom_update_block(&_loc_Tab,&_loc_EeTab,sizeof(_loc_Tab));
+#endif
+			_loc_State=MOTORCAL_IDLE;
+			break;
+	}
+	
+	// Das Speichern luft bereits mit dem neuen Tastverhltnis
+	return (_loc_State==MOTORCAL_SETTLE) || (_loc_State==MOTORCAL_MEASURE);
+}
+
+uint8_t motorcal_Step(void)
+{
+	return _loc_Step;
+}
+
+uint8_t motorcal_Valid(void)
+{
+	return _loc_Valid;
+}
+
+uint8_t motorcal_Duty(uint16_t rpm)
+{
+	uint8_t i, Shift;
+	int16_t Diff;
+	uint16_t Frac;
+	
+	if (!_loc_Valid)
+	{
+		if (rpm>=MOTORCAL_RPM_MAX) return 255;
+		return (uint8_t)(((uint32_t)rpm*255)/MOTORCAL_RPM_MAX);
+	}
+	
+	// Rasterpunkt und Rest direkt aus der Drehzahl, keine Suche
+	Shift=_loc_Tab.Shift;
+	if ((rpm>>Shift)>=MOTORCAL_GRID-1) return _loc_Tab.Duty[MOTORCAL_GRID-1];
+	i=(uint8_t)(rpm>>Shift);
+	Frac=rpm-((uint16_t)i<<Shift);
+	Diff=(int16_t)_loc_Tab.Duty[i+1]-_loc_Tab.Duty[i];
+	
+	return (uint8_t)(_loc_Tab.Duty[i]+(int16_t)(((int32_t)Diff*Frac)>>Shift));
+}
+
+#endif
@@ -0,0 +1,82 @@
+/************************************************************/
+/* Kennlinie PWM -> Drehzahl fr die Vorsteuerung			*/
+/*															*/
+/* Die Kalibrierung fhrt das Tastverhltnis in				*/
+/* MOTORCAL_POINTS Stufen von 0 bis 255 durch und misst je	*/
+/* Stufe die eingeschwungene Drehzahl. Daraus wird die		*/
+/* umgekehrte Kennlinie auf einem gleichmssigen Raster		*/
+/* (Schrittweite 1<<Shift U/min) berechnet, damit			*/
+/* motorcal_Duty ohne Suche und ohne Division auskommt.		*/
+/*															*/
+/* Die Tabelle liegt im EEPROM, mit EELOG im Kalibrier-		*/
+/* bereich von eelog (nicht blockierend), sonst in einer	*/
+/* eigenen EEMEM-Variable.									*/
+/*															*/
+/* Aktiv nur mit #define MOTORCAL							*/
+/************************************************************/
+
+#ifndef MOTORCAL_H
+#define MOTORCAL_H
+
+#include <stdint.h>
+#include "messcfg.h"
+
+// Anzahl der gemessenen Stufen (Tastverhltnis 0..255 gleichmssig verteilt)
+#ifndef MOTORCAL_POINTS
+#define MOTORCAL_POINTS 9
+#endif
+
+// Sttzstellen der umgekehrten Kennlinie, Raster 0..(MOTORCAL_GRID-1)<<Shift U/min
+#ifndef MOTORCAL_GRID
+#define MOTORCAL_GRID 17
+#endif
+
+// Wartezeit nach jedem Wechsel der Stufe und Hchstdauer pro Stufe in ms
+#ifndef MOTORCAL_SETTLE_MS
+#define MOTORCAL_SETTLE_MS 1500
+#endif
+#ifndef MOTORCAL_TIMEOUT_MS
+#define MOTORCAL_TIMEOUT_MS 6000
+#endif
+
+// Zeitbasis der bergebenen Zeitstempel in s (systick in main.c)
+#ifndef MOTORCAL_TICK_US
+#define MOTORCAL_TICK_US (1000000UL/MESS_TICK_HZ)
+#endif
+
+// Lage der Tabelle im Kalibrierbereich von eelog
+#ifndef MOTORCAL_CAL_OFS
+#define MOTORCAL_CAL_OFS 0
+#endif
+
+// Ersatzkennlinie ohne Kalibrierung: linear, 255 entspricht MOTORCAL_RPM_MAX
+#ifndef MOTORCAL_RPM_MAX
+#define MOTORCAL_RPM_MAX 12000
+#endif
+
+// Tabelle aus dem EEPROM laden
+// Rckgabe: 1 wenn eine gltige Tabelle vorhanden ist
+uint8_t motorcal_Init(void);
+
+// Kalibrierung starten, now = aktueller Tick
+// Das Tastverhltnis (OCR0) gehrt bis zum Ende der Kalibrierung dem Modul.
+void motorcal_Start(uint16_t now);
+
+// Ablaufsteuerung, in der Hauptschleife aufrufen
+// Rckgabe: 1 solange die Kalibrierung luft
+uint8_t motorcal_Task(uint16_t now);
+
+// Neuen Drehzahl-Messwert bergeben (wird nur whrend der Kalibrierung ausgewertet)
+void motorcal_Sample(uint16_t rpm);
+
+// Aktuelle Stufe (0..MOTORCAL_POINTS-1) fr eine Fortschrittsanzeige
+uint8_t motorcal_Step(void);
+
+// Tastverhltnis fr eine Solldrehzahl (interpoliert, O(1))
+// Ohne gltige Tabelle wird die lineare Ersatzkennlinie verwendet.
+uint8_t motorcal_Duty(uint16_t rpm);
+
+// 1 wenn eine gemessene Tabelle verwendet wird
+uint8_t motorcal_Valid(void);
+
+#endif
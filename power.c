@@ -0,0 +1,76 @@
+/************************************************************/
+/* Implementierung von power.h								*/
+/*															*/
+/************************************************************/
+
+#ifdef EVENT
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/sleep.h>
+#include <util/atomic.h>
+#include "messcfg.h"
+#include "power.h"
+
+// Messfenster: 1s in Abtast-Ticks
+#define POWER_WINDOW ((uint16_t)MESS_TICK_HZ)
+
+static uint16_t _loc_Wakes = 0;
+static uint32_t _loc_Slept = 0;
+static uint16_t _loc_T0 = 0;
+static uint16_t _loc_LastWakes = 0;
+static uint16_t _loc_LastPermille = 0;
+
+void power_Init(void)
+{
+	set_sleep_mode(SLEEP_MODE_IDLE);
+	_loc_Wakes=0;
+	_loc_Slept=0;
+}
+
+void power_Sleep(void)
+{
+	uint16_t t0, t1;
+	
+	// Interrupts sind gesperrt: zwischen der Prfung des Aufrufers und dem Einschlafen
+	// kann kein Ereignis verloren gehen, sei() wirkt erst nach dem folgenden Befehl
+	t0=TCNT1;
+	sleep_enable();
+	sei();
+	sleep_cpu();
+	sleep_disable();
+	
+	// Die weckende ISR ist bereits gelaufen und wird mitgezhlt (wenige s).
+	// Der Tick weckt sptestens nach MESS_TICK_TOP Ticks, die Differenz passt in 16 Bit.
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		t1=TCNT1;
+	}
+	_loc_Slept+=(uint16_t)(t1-t0);
+	_loc_Wakes++;
+}
+
+uint8_t power_Tick(uint16_t tick)
+{
+	if ((uint16_t)(tick-_loc_T0)<POWER_WINDOW) return 0;
+	_loc_T0+=POWER_WINDOW;
+	
+	_loc_LastWakes=_loc_Wakes;
+	_loc_LastPermille=(uint16_t)(_loc_Slept/(MESS_TIMER_HZ/1000));
+	if (_loc_LastPermille>1000) _loc_LastPermille=1000;
+	_loc_Wakes=0;
+	_loc_Slept=0;
+	return 1;
+}
+
+uint16_t power_Wakes(void)
+{
+	return _loc_LastWakes;
+}
+
+uint16_t power_SleepPermille(void)
+{
+	return _loc_LastPermille;
+}
+
+#endif
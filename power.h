@@ -0,0 +1,35 @@
+/************************************************************/
+/* Schlafen im Leerlauf (SLEEP_MODE_IDLE) mit Statistik		*/
+/*															*/
+/* Die Hauptschleife ruft power_Sleep auf, wenn weder eine	*/
+/* Flanke noch ein Tick auf die Bearbeitung wartet. Die		*/
+/* Timer, die USART und das EEPROM laufen im Idle weiter,	*/
+/* jeder Interrupt weckt die CPU wieder auf.				*/
+/* Gezhlt werden die Aufwachvorgnge und die geschlafene	*/
+/* Zeit in Timer1-Ticks, daraus ergibt sich der Anteil der	*/
+/* Zeit, in der die CPU arbeitet.							*/
+/*															*/
+/* Aktiv nur mit #define EVENT								*/
+/************************************************************/
+
+#ifndef POWER_H
+#define POWER_H
+
+#include <stdint.h>
+
+// Schlafmodus einstellen und Statistik zurcksetzen
+void power_Init(void);
+
+// Mit gesperrten Interrupts aufrufen, nachdem geprft wurde, dass nichts ansteht.
+// Kehrt nach dem ersten Interrupt zurck, die Interrupts sind danach freigegeben.
+void power_Sleep(void);
+
+// Einmal pro Tick aufrufen (tick = systick), schliesst jede Sekunde ein Messfenster ab
+// Rckgabe: 1 wenn ein neues Messfenster vorliegt
+uint8_t power_Tick(uint16_t tick);
+
+// Ergebnisse des letzten vollen Messfensters (1s)
+uint16_t power_Wakes(void);		// Aufwachvorgnge pro Sekunde
+uint16_t power_SleepPermille(void);	// geschlafener Anteil in Promille
+
+#endif
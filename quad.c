@@ -0,0 +1,103 @@
+/************************************************************/
+/* Implementierung von quad.h								*/
+/*															*/
+/************************************************************/
+
+#ifdef QUAD
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <util/atomic.h>
+#include "quad.h"
+
+// Zustand = (B<<1)|A, so liegen beide Spuren direkt nebeneinander in PIND
+#define QUAD_PINS	PIND
+#define QUAD_SHIFT	PD2
+
+// Ungltiger bergang in der Tabelle
+#define QUAD_ERR	2
+
+// Schritt fr (alter Zustand<<2)|neuer Zustand
+// vorwrts 0->1->3->2->0, rckwrts umgekehrt, gleicher Zustand = 0
+static const int8_t _loc_Step[16] =
+{
+	 0,  1, -1, QUAD_ERR,
+	-1,  0, QUAD_ERR,  1,
+	 1, QUAD_ERR,  0, -1,
+	QUAD_ERR, -1,  1,  0
+};
+
+static volatile int32_t _loc_Pos = 0;
+static volatile uint16_t _loc_Errors = 0;
+static volatile int8_t _loc_Dir = 0;
+static uint8_t _loc_State;
+
+void quad_Init(void)
+{
+	DDRD&=~((1<<PD2)|(1<<PD3));
+	PORTD&=~((1<<PD2)|(1<<PD3));
+	
+	_loc_State=(QUAD_PINS>>QUAD_SHIFT)&3;
+	
+	// Jede Flanke an INT0 und INT1, alte Anforderungen lschen
+	MCUCR=(MCUCR&~((1<<ISC01)|(1<<ISC11)))|(1<<ISC00)|(1<<ISC10);
+	GIFR=(1<<INTF0)|(1<<INTF1);
+	GICR|=(1<<INT0)|(1<<INT1);
+}
+
+int32_t quad_Position(void)
+{
+	int32_t Pos;
+	
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		Pos=_loc_Pos;
+	}
+	return Pos;
+}
+
+void quad_Reset(void)
+{
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		_loc_Pos=0;
+	}
+}
+
+int8_t quad_Direction(void)
+{
+	return _loc_Dir;
+}
+
+uint16_t quad_Errors(void)
+{
+	uint16_t Errors;
+	
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		Errors=_loc_Errors;
+	}
+	return Errors;
+}
+
+// Beide Spuren, eine Routine: INT1 springt direkt in die ISR von INT0
+ISR(INT0_vect)
+{
+	uint8_t New = (QUAD_PINS>>QUAD_SHIFT)&3;
+	int8_t d = _loc_Step[(_loc_State<<2)|New];
+	
+	_loc_State=New;
+	if (d==QUAD_ERR)
+	{
+		_loc_Errors++;
+	}
+	else if (d)
+	{
+		_loc_Pos+=d;
+		_loc_Dir=d;
+	}
+}
+
+ISR(INT1_vect, ISR_ALIASOF(INT0_vect));
+
+#endif
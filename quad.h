@@ -0,0 +1,41 @@
+/************************************************************/
+/* Quadratur-Auswertung mit zwei Lichtschranken				*/
+/*															*/
+/* Spur A an INT0 (PD2), Spur B an INT1 (PD3), beide		*/
+/* Interrupts lsen bei jeder Flanke aus. Die ISR liest		*/
+/* beide Spuren gleichzeitig und bestimmt den Schritt ber	*/
+/* eine Tabelle mit 16 Eintrgen (alter und neuer Zustand).	*/
+/* Jede Flanke zhlt, das ergibt die 4-fache Auflsung		*/
+/* gegenber dem Zhlen der Impulse einer Spur.				*/
+/* bergnge, bei denen sich beide Spuren gleichzeitig		*/
+/* gendert haben, bedeuten eine verlorene Flanke und		*/
+/* werden gezhlt.											*/
+/*															*/
+/* Aktiv nur mit #define QUAD								*/
+/************************************************************/
+
+#ifndef QUAD_H
+#define QUAD_H
+
+#include <stdint.h>
+#include "messcfg.h"
+
+// Schritte pro Umdrehung der Geberscheibe (jede Flanke beider Spuren)
+#define QUAD_STEPS_PER_REV (4*MESS_PPR)
+
+// Eingnge konfigurieren (Pull-ups aus) und Interrupts freigeben
+void quad_Init(void);
+
+// Position in Schritten (vorwrts = A eilt B voraus)
+int32_t quad_Position(void);
+
+// Position auf 0 setzen, der Fehlerzhler bleibt erhalten
+void quad_Reset(void);
+
+// Drehrichtung des letzten gltigen Schritts: 1, -1 oder 0 (noch kein Schritt)
+int8_t quad_Direction(void);
+
+// Anzahl ungltiger bergnge (beide Spuren gleichzeitig)
+uint16_t quad_Errors(void);
+
+#endif
@@ -0,0 +1,212 @@
+/************************************************************/
+/* Implementierung von slotmon.h							*/
+/*															*/
+/************************************************************/
+
+#ifdef SLOTMON
+
+#include "slotmon.h"
+#include "tacho.h"
+
+#if (SLOTMON_LO >= SLOTMON_HI) || (SLOTMON_HI > 1000) || (SLOTMON_SPREAD > 1000)
+#error "SLOTMON_LO < SLOTMON_HI <= 1000 und SLOTMON_SPREAD <= 1000 erforderlich"
+#elif (SLOTMON_SHIFT < 1) || (SLOTMON_SHIFT > 8) || (SLOTMON_WARMUP < 1) || (SLOTMON_WARMUP > 255)
+#error "SLOTMON_SHIFT muss 1..8 und SLOTMON_WARMUP 1..255 sein"
+#endif
+
+// Grenzen im Format der Mittelwerte (Tastverhltnis * 65536), zur Compile-Zeit umgerechnet
+#define SLOTMON_Q16(pm) (((pm)>=1000)?0xFFFFU:(uint16_t)(((uint32_t)(pm)*65536UL+500)/1000))
+#define SLOTMON_LO_Q16 SLOTMON_Q16(SLOTMON_LO)
+#define SLOTMON_HI_Q16 SLOTMON_Q16(SLOTMON_HI)
+#define SLOTMON_SPREAD_Q16 SLOTMON_Q16(SLOTMON_SPREAD)
+
+static uint16_t _loc_Rise;				// Zeitstempel der letzten gltigen steigenden Flanke
+static uint16_t _loc_RiseTick;			// systick dazu
+static uint16_t _loc_Fall;				// Zeitstempel der letzten fallenden Flanke
+static uint16_t _loc_Period;			// letzte gltige Periode, 0 = noch keine
+static uint8_t _loc_Run = 0;			// 1 sobald eine steigende Flanke gesehen wurde
+static uint8_t _loc_FallOk;				// 1 wenn seit _loc_Rise eine fallende Flanke kam
+static uint8_t _loc_Slot;				// Schlitz des nchsten Impulses
+
+static uint16_t _loc_Mean[MESS_PPR];	// gleitender Mittelwert, Tastverhltnis * 65536
+static uint8_t _loc_Min[MESS_PPR];		// Tastverhltnis * 256
+static uint8_t _loc_Max[MESS_PPR];
+static uint8_t _loc_N[MESS_PPR];		// Impulse je Schlitz, bleibt bei 255 stehen
+
+static uint16_t _loc_Glitches = 0;
+static uint8_t _loc_Flags = 0;
+
+// h/p in 1/256 fr h < p, 8 Schritte Schieben und Subtrahieren
+// 2h >= p wird als h >= p-h geprft, so luft nichts ber 16 Bit
+static uint8_t _loc_Ratio(uint16_t h, uint16_t p)
+{
+	uint8_t q = 0, i;
+
+	for (i=0;i<8;i++)
+	{
+		q<<=1;
+		if (h>=p-h)
+		{
+			h-=p-h;
+			q|=1;
+		}
+		else
+		{
+			h<<=1;
+		}
+	}
+	return q;
+}
+
+void slotmon_Restart(void)
+{
+	uint8_t i;
+
+	for (i=0;i<MESS_PPR;i++)
+	{
+		_loc_Mean[i]=0;
+		_loc_Min[i]=0xFF;
+		_loc_Max[i]=0;
+		_loc_N[i]=0;
+	}
+	_loc_Run=0;
+	_loc_FallOk=0;
+	_loc_Period=0;
+	_loc_Slot=0;
+}
+
+void slotmon_Reset(void)
+{
+	slotmon_Restart();
+	_loc_Glitches=0;
+	_loc_Flags=0;
+}
+
+// Ein Impuls: High-Phase h und Periode p in Timer1-Ticks
+static void _loc_Sample(uint16_t h, uint16_t p)
+{
+	uint8_t s = _loc_Slot, d;
+	uint16_t m, x;
+
+	if (++_loc_Slot>=MESS_PPR) _loc_Slot=0;
+
+	d=_loc_Ratio(h,p);
+	x=(uint16_t)d<<8;
+	if (_loc_N[s]==0)
+	{
+		m=x;
+	}
+	else
+	{
+		m=_loc_Mean[s];
+		if (x>=m) m+=(x-m)>>SLOTMON_SHIFT;
+		else m-=(m-x)>>SLOTMON_SHIFT;
+	}
+	_loc_Mean[s]=m;
+	if (d<_loc_Min[s]) _loc_Min[s]=d;
+	if (d>_loc_Max[s]) _loc_Max[s]=d;
+	if (_loc_N[s]<0xFF) _loc_N[s]++;
+
+	// Grenzen nur fr diesen Schlitz, die Spreizung erst in slotmon_Flags
+	if (_loc_N[s]>=SLOTMON_WARMUP)
+	{
+		if (m<SLOTMON_LO_Q16) _loc_Flags|=SLOTMON_LOW;
+		if (m>SLOTMON_HI_Q16) _loc_Flags|=SLOTMON_HIGH;
+	}
+}
+
+void slotmon_Edge(uint8_t rising, uint16_t stamp, uint16_t tick)
+{
+	uint16_t p;
+
+	if (!rising)
+	{
+		_loc_Fall=stamp;
+		_loc_FallOk=1;
+		return;
+	}
+
+	// Erste Flanke oder zu lange Pause: Zeitstempel nicht vergleichbar, Phase neu beginnen
+	if (!_loc_Run || ((uint16_t)(tick-_loc_RiseTick)>=TACHO_GAP_TICKS))
+	{
+		_loc_Run=1;
+		_loc_Rise=stamp;
+		_loc_RiseTick=tick;
+		_loc_FallOk=0;
+		_loc_Period=0;
+		return;
+	}
+
+	// Strimpuls wie in tacho_Edge: die Periode luft von der letzten gltigen Flanke weiter,
+	// als Ende der High-Phase gilt die letzte fallende Flanke davor
+	p=stamp-_loc_Rise;
+	if ((p<SLOTMON_MIN_PERIOD) || (p<(_loc_Period>>2)))
+	{
+		if (_loc_Glitches<0xFFFF) _loc_Glitches++;
+		if (_loc_Glitches>=SLOTMON_GLITCH_MAX) _loc_Flags|=SLOTMON_GLITCH;
+		return;
+	}
+
+	if (_loc_FallOk)
+	{
+		_loc_Sample(_loc_Fall-_loc_Rise,p);
+	}
+	else
+	{
+		// Ohne fallende Flanke ist der Schlitz nicht messbar, zhlt aber fr die Zuordnung
+		_loc_Flags|=SLOTMON_MISSED;
+		if (++_loc_Slot>=MESS_PPR) _loc_Slot=0;
+	}
+	_loc_Rise=stamp;
+	_loc_RiseTick=tick;
+	_loc_Period=p;
+	_loc_FallOk=0;
+}
+
+// Tastverhltnis * 65536 in Promille
+static uint16_t _loc_Permille(uint16_t q16)
+{
+	return (uint16_t)(((uint32_t)q16*1000+32768)>>16);
+}
+
+uint16_t slotmon_Duty(uint8_t slot)
+{
+	if ((slot>=MESS_PPR) || (_loc_N[slot]==0)) return 0;
+	return _loc_Permille(_loc_Mean[slot]);
+}
+
+uint16_t slotmon_Min(uint8_t slot)
+{
+	if ((slot>=MESS_PPR) || (_loc_N[slot]==0)) return 0;
+	return _loc_Permille((uint16_t)_loc_Min[slot]<<8);
+}
+
+uint16_t slotmon_Max(uint8_t slot)
+{
+	if ((slot>=MESS_PPR) || (_loc_N[slot]==0)) return 0;
+	return _loc_Permille((uint16_t)_loc_Max[slot]<<8);
+}
+
+uint16_t slotmon_Glitches(void)
+{
+	return _loc_Glitches;
+}
+
+uint8_t slotmon_Flags(void)
+{
+	uint16_t lo = 0xFFFF, hi = 0, m;
+	uint8_t i;
+
+	// Spreizung erst, wenn alle Schlitze eingeschwungen sind
+	for (i=0;i<MESS_PPR;i++)
+	{
+		if (_loc_N[i]<SLOTMON_WARMUP) return _loc_Flags;
+		m=_loc_Mean[i];
+		if (m<lo) lo=m;
+		if (m>hi) hi=m;
+	}
+	if ((uint16_t)(hi-lo)>SLOTMON_SPREAD_Q16) _loc_Flags|=SLOTMON_SKEW;
+	return _loc_Flags;
+}
+
+#endif
@@ -0,0 +1,95 @@
+/************************************************************/
+/* berwachung der Lichtschranke ber das Tastverhltnis	*/
+/*															*/
+/* Verschmutzt oder verstellt sich die Lichtschranke,		*/
+/* verschiebt sich das Verhltnis von Hell- zu Dunkelphase	*/
+/* lange bevor Flanken verloren gehen. Dazu werden beide	*/
+/* Flanken von Kanal 0 ausgewertet: pro Impuls ergibt sich	*/
+/* der Anteil der High-Phase an der Periode. Je Schlitz der	*/
+/* Geberscheibe (Impuls modulo MESS_PPR) laufen ein			*/
+/* gleitender Mittelwert sowie Minimum und Maximum mit.		*/
+/*															*/
+/* Warnbits werden gesetzt und bleiben stehen, wenn ein		*/
+/* Schlitz ausserhalb von SLOTMON_LO..SLOTMON_HI liegt, die	*/
+/* Schlitze zu weit auseinanderlaufen oder zu viele			*/
+/* Strimpulse kommen. Ohne Indexmarke ist die Zuordnung	*/
+/* zu den Schlitzen nur stabil, solange keine Flanke		*/
+/* verloren geht.											*/
+/*															*/
+/* Eine fallende Flanke kostet nur das Sichern des			*/
+/* Zeitstempels. Pro Impuls folgen eine Division in 8		*/
+/* Schritten (ohne Divisionsroutine) und ein Mittelwert-	*/
+/* schritt mit Shift, die Spreizung ber alle Schlitze		*/
+/* wird erst beim Abfragen der Warnbits bestimmt.			*/
+/*															*/
+/* Aktiv nur mit #define SLOTMON (braucht TACHO)			*/
+/************************************************************/
+
+#ifndef SLOTMON_H
+#define SLOTMON_H
+
+#include <stdint.h>
+#include "messcfg.h"
+
+// Zulssiger Bereich des mittleren Tastverhltnisses je Schlitz in Promille
+#ifndef SLOTMON_LO
+#define SLOTMON_LO 250
+#endif
+#ifndef SLOTMON_HI
+#define SLOTMON_HI 750
+#endif
+
+// Grsste zulssige Differenz der Mittelwerte zwischen den Schlitzen in Promille
+#ifndef SLOTMON_SPREAD
+#define SLOTMON_SPREAD 100
+#endif
+
+// Zeitkonstante des gleitenden Mittelwerts: 2^SLOTMON_SHIFT Impulse je Schlitz
+#ifndef SLOTMON_SHIFT
+#define SLOTMON_SHIFT 4
+#endif
+
+// Impulse je Schlitz, bevor die Grenzen geprft werden (<= 255)
+#ifndef SLOTMON_WARMUP
+#define SLOTMON_WARMUP (2<<SLOTMON_SHIFT)
+#endif
+
+// Strimpulse (zu kurze Perioden) bis zur Warnung
+#ifndef SLOTMON_GLITCH_MAX
+#define SLOTMON_GLITCH_MAX 16
+#endif
+
+// Krzeste gltige Periode in Timer1-Ticks, wie bei tacho.h
+#ifndef SLOTMON_MIN_PERIOD
+#define SLOTMON_MIN_PERIOD ((uint16_t)(MESS_K_PERIOD/20000UL))
+#endif
+
+// Warnbits von slotmon_Flags
+#define SLOTMON_LOW		0x01	// ein Schlitz unter SLOTMON_LO
+#define SLOTMON_HIGH	0x02	// ein Schlitz ber SLOTMON_HI
+#define SLOTMON_SKEW	0x04	// Schlitze weiter als SLOTMON_SPREAD auseinander
+#define SLOTMON_GLITCH	0x08	// mindestens SLOTMON_GLITCH_MAX Strimpulse
+#define SLOTMON_MISSED	0x10	// steigende Flanke ohne fallende dazwischen
+
+// Alles zurcksetzen, auch die Warnbits
+void slotmon_Reset(void);
+
+// Statistik neu beginnen, die Warnbits bleiben stehen (z.B. nach einem Stillstand)
+void slotmon_Restart(void);
+
+// Eine Flanke von Kanal 0 bergeben (rising != 0 fr steigend, stamp = Timer1, tick = systick)
+// Steigende und fallende Flanken mssen sich abwechseln.
+void slotmon_Edge(uint8_t rising, uint16_t stamp, uint16_t tick);
+
+// Ergebnisse je Schlitz (0..MESS_PPR-1) in Promille, 0 solange keine Werte vorliegen
+uint16_t slotmon_Duty(uint8_t slot);	// gleitender Mittelwert
+uint16_t slotmon_Min(uint8_t slot);
+uint16_t slotmon_Max(uint8_t slot);
+
+// Strimpulse seit dem letzten slotmon_Reset
+uint16_t slotmon_Glitches(void);
+
+// Warnbits (SLOTMON_LOW...), bleiben bis slotmon_Reset gesetzt
+uint8_t slotmon_Flags(void);
+
+#endif
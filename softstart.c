@@ -0,0 +1,57 @@
+/************************************************************/
+/* Implementierung von softstart.h							*/
+/*															*/
+/************************************************************/
+
+#ifdef SOFTSTART
+
+#include <util/atomic.h>
+#include "softstart.h"
+
+#if (SOFTSTART_DIV < 1) || (SOFTSTART_DIV > 65535)
+#error "SOFTSTART_MS ergibt weniger als einen oder mehr als 65535 Ticks pro Stufe"
+#endif
+
+// S-Kurve 6x^5-15x^4+10x^3 bei x = (k+1)/SOFTSTART_STEPS in 1/256, zur Compile-Zeit berechnet
+#define _SOFTSTART_X(k) (((k)+1.0)/SOFTSTART_STEPS)
+#define _SOFTSTART_S(x) ((x)*(x)*(x)*((x)*((x)*6.0-15.0)+10.0))
+#define _SOFTSTART_V(k) (_SOFTSTART_S(_SOFTSTART_X(k))*256.0+0.5)
+#define _SOFTSTART_Q8(k) ((uint8_t)((_SOFTSTART_V(k)>255.0)?255.0:_SOFTSTART_V(k)))
+#define _SOFTSTART_8(k) _SOFTSTART_Q8(k), _SOFTSTART_Q8(k+1), _SOFTSTART_Q8(k+2), _SOFTSTART_Q8(k+3), \
+	_SOFTSTART_Q8(k+4), _SOFTSTART_Q8(k+5), _SOFTSTART_Q8(k+6), _SOFTSTART_Q8(k+7)
+
+const uint8_t softstart_Curve[SOFTSTART_STEPS] PROGMEM = {
+	_SOFTSTART_8(0), _SOFTSTART_8(8), _SOFTSTART_8(16), _SOFTSTART_8(24),
+	_SOFTSTART_8(32), _SOFTSTART_8(40), _SOFTSTART_8(48), _SOFTSTART_8(56) };
+
+uint8_t softstart_K = SOFTSTART_STEPS;
+uint16_t softstart_Cnt;
+uint8_t softstart_From;
+uint8_t softstart_Span;
+uint8_t softstart_Up;
+uint8_t softstart_To;
+
+void softstart_Start(uint8_t to)
+{
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		softstart_From=OCR0;
+		softstart_To=to;
+		softstart_Up=(to>=softstart_From);
+		softstart_Span=softstart_Up?to-softstart_From:softstart_From-to;
+		softstart_Cnt=SOFTSTART_DIV;
+		softstart_K=0;
+	}
+}
+
+void softstart_Stop(void)
+{
+	softstart_K=SOFTSTART_STEPS;
+}
+
+uint8_t softstart_Active(void)
+{
+	return softstart_K<SOFTSTART_STEPS;
+}
+
+#endif
@@ -0,0 +1,88 @@
+/************************************************************/
+/* Sanftanlauf: PWM-Rampe entlang einer S-Kurve				*/
+/*															*/
+/* Statt das Tastverhltnis in einem Schritt zu setzen,		*/
+/* fhrt die Rampe es in SOFTSTART_STEPS Stufen vom			*/
+/* aktuellen Wert zum Ziel. Die Form ist die Polynomkurve	*/
+/* 6x^5-15x^4+10x^3: Geschwindigkeit und Beschleunigung		*/
+/* sind an beiden Enden 0, der Ruck bleibt begrenzt. Das	*/
+/* verringert den Einschaltstrom und das berschwingen,		*/
+/* whrend die Drehzahlmessung nachzieht.					*/
+/*															*/
+/* Die Kurve wird beim bersetzen berechnet und liegt im	*/
+/* Flash. softstart_Tick luft im Timer-Interrupt, pro		*/
+/* Stufe kostet es einen Tabellenzugriff und eine 8x8 Bit	*/
+/* Hardware-Multiplikation fr die Skalierung auf das Ziel.	*/
+/*															*/
+/* bergabe: solange softstart_Active() 1 liefert, gehrt	*/
+/* OCR0 der Rampe. Danach steht OCR0 genau auf dem Ziel und	*/
+/* eine Regelung kann stossfrei von diesem Wert aus			*/
+/* weitermachen.											*/
+/*															*/
+/* Aktiv nur mit #define SOFTSTART							*/
+/************************************************************/
+
+#ifndef SOFTSTART_H
+#define SOFTSTART_H
+
+#include <stdint.h>
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+#include "messcfg.h"
+
+// Dauer der Rampe in ms
+#ifndef SOFTSTART_MS
+#define SOFTSTART_MS 1000
+#endif
+
+// Stufen der Kurve (Lnge der Tabelle, fest)
+#define SOFTSTART_STEPS 64
+
+// Abtast-Ticks pro Stufe
+#define SOFTSTART_DIV (SOFTSTART_MS*MESS_TICK_HZ/(1000UL*SOFTSTART_STEPS))
+
+#ifdef SOFTSTART
+
+// Kurve in 1/256, Eintrag k gehrt zur Stufe k+1 (der letzte Eintrag wird nicht benutzt)
+extern const uint8_t softstart_Curve[SOFTSTART_STEPS] PROGMEM;
+
+extern uint8_t softstart_K;		// nchste Stufe, SOFTSTART_STEPS = keine Rampe aktiv
+extern uint16_t softstart_Cnt;	// Ticks bis zur nchsten Stufe
+extern uint8_t softstart_From;	// Tastverhltnis beim Start
+extern uint8_t softstart_Span;	// Betrag Ziel - Start
+extern uint8_t softstart_Up;	// 1 = aufwrts
+extern uint8_t softstart_To;	// Ziel
+
+// Einmal pro Abtast-Tick aus dem Timer-Interrupt aufrufen
+// inline, damit die ISR keine Funktion aufrufen muss
+static inline void softstart_Tick(void)
+{
+	uint8_t k = softstart_K, d;
+
+	if (k>=SOFTSTART_STEPS) return;
+	if (--softstart_Cnt) return;
+	softstart_Cnt=SOFTSTART_DIV;
+	softstart_K=k+1;
+	if (k+1>=SOFTSTART_STEPS)
+	{
+		OCR0=softstart_To;
+	}
+	else
+	{
+		d=((uint16_t)softstart_Span*pgm_read_byte(&softstart_Curve[k]))>>8;
+		OCR0=softstart_Up?softstart_From+d:softstart_From-d;
+	}
+}
+
+#endif
+
+// Rampe vom aktuellen OCR0 zum Tastverhltnis to starten
+void softstart_Start(uint8_t to);
+
+// Rampe beim aktuellen Wert anhalten, OCR0 gehrt danach wieder dem Aufrufer
+void softstart_Stop(void);
+
+// 1 solange die Rampe luft
+uint8_t softstart_Active(void);
+
+#endif
@@ -0,0 +1,91 @@
+/************************************************************/
+/* Implementierung von stackmon.h							*/
+/*															*/
+/************************************************************/
+
+#ifdef STACKMON
+
+#include <avr/io.h>
+#include "stackmon.h"
+
+// Linker-Symbole der avr-libc
+extern uint8_t __data_start;
+extern uint8_t __data_end;
+extern uint8_t __bss_start;
+extern uint8_t __bss_end;
+extern uint8_t _end;
+extern uint8_t __stack;
+
+static uint16_t _loc_MinUnused = 0xFFFF;
+
+// Den freien RAM mit dem Fllmuster beschreiben
+// Luft in .init1, also vor dem Aufsetzen des Stacks und vor dem Lschen von .bss.
+// Deshalb in Assembler und ohne Zugriff auf Register, die der C-Code voraussetzt.
+void _loc_StackPaint(void) __attribute__ ((naked, used, section (".init1")));
+void _loc_StackPaint(void)
+{
+	__asm volatile (
+		"    ldi r30,lo8(_end)\n"
+		"    ldi r31,hi8(_end)\n"
+		"    ldi r24,%0\n"
+		"    ldi r25,hi8(__stack)\n"
+		"    rjmp 2f\n"
+		"1:  st Z+,r24\n"
+		"2:  cpi r30,lo8(__stack)\n"
+		"    cpc r31,r25\n"
+		"    brlo 1b\n"
+		"    breq 1b"
+		:
+		: "i" (STACKMON_CANARY)
+	);
+}
+
+uint16_t stackmon_DataSize(void)
+{
+	return (uint16_t)(&__data_end-&__data_start);
+}
+
+uint16_t stackmon_BssSize(void)
+{
+	return (uint16_t)(&__bss_end-&__bss_start);
+}
+
+uint16_t stackmon_FreeTotal(void)
+{
+	return (uint16_t)(&__stack-&_end)+1;
+}
+
+uint16_t stackmon_Headroom(void)
+{
+	return SP-(uint16_t)&_end;
+}
+
+// Zhlt die Bytes ab dem .bss Ende, die noch das Fllmuster tragen
+uint16_t stackmon_Unused(void)
+{
+	const uint8_t *p = &_end;
+	uint16_t Cnt = 0;
+	
+	while ((p<=&__stack) && (*p==STACKMON_CANARY))
+	{
+		p++;
+		Cnt++;
+	}
+	return Cnt;
+}
+
+uint16_t stackmon_Check(void)
+{
+	uint16_t Unused;
+	
+	Unused=stackmon_Unused();
+	if (Unused<_loc_MinUnused) _loc_MinUnused=Unused;
+	return _loc_MinUnused;
+}
+
+uint16_t stackmon_MinUnused(void)
+{
+	return _loc_MinUnused;
+}
+
+#endif
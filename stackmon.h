@@ -0,0 +1,47 @@
+/************************************************************/
+/* berwachung von Stack und SRAM							*/
+/*															*/
+/* Beim Start wird der freie RAM zwischen dem Ende von		*/
+/* .data/.bss und dem Stack mit einem Muster gefllt.		*/
+/* Zur Laufzeit wird gezhlt, wie viele Bytes das Muster	*/
+/* noch tragen (= nie vom Stack benutzter Bereich).			*/
+/*															*/
+/* Die kleinste Reserve geht mit TELEMETRY im				*/
+/* Status-Rahmen hinaus, auf Anzeigen mit mehr als			*/
+/* zwei Zeilen steht sie zustzlich im Feld "Stk".			*/
+/* Das 2x8 HD44780 hat dafr keinen Platz.					*/
+/*															*/
+/* Aktiv nur mit #define STACKMON							*/
+/************************************************************/
+
+#ifndef STACKMON_H
+#define STACKMON_H
+
+#include <stdint.h>
+
+// Fllmuster fr den freien RAM
+#define STACKMON_CANARY 0xC5
+
+// Statische Belegung: Grsse von .data und .bss in Bytes (aus den Linker-Symbolen)
+uint16_t stackmon_DataSize(void);
+uint16_t stackmon_BssSize(void);
+
+// Grsse des Bereichs zwischen .bss Ende und RAMEND, den Heap und Stack teilen
+uint16_t stackmon_FreeTotal(void);
+
+// Aktueller Abstand zwischen Stackpointer und .bss Ende in Bytes
+uint16_t stackmon_Headroom(void);
+
+// Anzahl Bytes, die seit dem Start nie vom Stack benutzt wurden (High-Water-Mark)
+// Die Funktion durchsucht den RAM ab dem .bss Ende, Laufzeit proportional zum freien RAM.
+uint16_t stackmon_Unused(void);
+
+// stackmon_Unused aufrufen und das bisherige Minimum nachfhren
+// Gedacht fr den Aufruf nach jeder Messung bzw. Display-nderung.
+// Rckgabe: kleinste bisher gemessene Reserve in Bytes
+uint16_t stackmon_Check(void);
+
+// Kleinste bisher mit stackmon_Check gemessene Reserve (0xFFFF = noch nie geprft)
+uint16_t stackmon_MinUnused(void);
+
+#endif
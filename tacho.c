@@ -0,0 +1,355 @@
+/************************************************************/
+/* Implementierung von tacho.h								*/
+/*															*/
+/************************************************************/
+
+#ifdef TACHO
+
+#include "tacho.h"
+#ifdef SLOTMON
+#include "slotmon.h"
+#endif
+
+#if (TACHO_WINDOW & (TACHO_WINDOW-1)) || (TACHO_WINDOW > 64)
+#error "TACHO_WINDOW muss eine Zweierpotenz <= 64 sein"
+#endif
+
+#if (TACHO_CHANNELS < 1)
+#error "TACHO_MASK muss mindestens ein Bit enthalten"
+#endif
+
+// Drehzahl = MESS_K_PERIOD * Anzahl / Summe der Perioden, das Produkt muss in 32 Bit passen
+#if ((60*MESS_TIMER_HZ*MESS_GEAR_NUM)/(MESS_PPR*MESS_GEAR_DEN))*TACHO_WINDOW > 0xFFFFFFFF
+#error "MESS_K_PERIOD * TACHO_WINDOW passt nicht in 32 Bit, TACHO_WINDOW verkleinern"
+#endif
+
+#ifdef TACHO_ESTIM
+// Schtzung und Beschleunigung rechnen mit der Drehzahl in Q4 (MESS_K_PERIOD*16) in int32_t
+#if ((60*MESS_TIMER_HZ*MESS_GEAR_NUM)/(MESS_PPR*MESS_GEAR_DEN))*16 > 0x7FFFFFFF
+#error "MESS_K_PERIOD * 16 passt nicht in int32_t, MESS_TIMER_HZ oder MESS_GEAR_NUM zu gross"
+#endif
+#endif
+
+// Zeitbasis fr die Abtastrate: 1s in Abtast-Ticks
+#if MESS_TICK_HZ > 65535
+#error "MESS_TICK_HZ > 65535, die Abtastrate kann nicht gezaehlt werden"
+#endif
+#define TACHO_RATE_TICKS ((uint16_t)MESS_TICK_HZ)
+
+#ifdef TACHO_ESTIM
+// Verstrkungen des Alpha-Beta-Filters, zur Compile-Zeit berechnet
+// alpha in Q8, beta = alpha^2/(2-alpha) in Q12 (beta ist klein und braucht mehr Auflsung)
+#define TACHO_ALPHA_Q8 (TACHO_ALPHA)
+#define TACHO_BETA_Q12 ((16L*TACHO_ALPHA*TACHO_ALPHA+(512-TACHO_ALPHA)/2)/(512-TACHO_ALPHA))
+#if (TACHO_ALPHA < 1) || (TACHO_ALPHA > 255) || (TACHO_BETA_Q12 < 1)
+#error "TACHO_ALPHA muss zwischen 1 und 255 liegen (und nicht zu klein, beta wird sonst 0)"
+#endif
+#endif
+
+tacho_t tacho_Ch[TACHO_CHANNELS];
+
+// Bit im Port fr jeden Kanal, wird einmal aus TACHO_MASK erzeugt
+static uint8_t _loc_Bit[TACHO_CHANNELS];
+static uint8_t _loc_Pins;
+
+static uint32_t _loc_Scans = 0;
+static uint32_t _loc_Rate = 0;
+static uint16_t _loc_RateT0 = 0;
+
+// Median, Fenster und Schtzung leeren, die Drehzahl bleibt stehen
+static void _loc_Clear(tacho_t *t)
+{
+	uint8_t i;
+	
+	t->RawN=0;
+	t->Ix=0;
+	t->Fill=0;
+	t->Sum=0;
+	for (i=0;i<TACHO_WINDOW;i++) t->Win[i]=0;
+#ifdef TACHO_ESTIM
+	t->EstP=0;
+	t->EstD=0;
+#endif
+}
+
+void tacho_Init(tacho_t *t)
+{
+	_loc_Clear(t);
+	t->Run=0;
+	t->Rpm=0;
+	t->Rejected=0;
+}
+
+// Zeit seit der letzten gltigen Flanke in Timer1-Ticks, auch ber berlufe von Timer1 hinweg.
+// Bis zu einem halben berlauf gengt die Differenz der Zeitstempel. Darber liefert systick
+// die ungefhre Zeit und damit die Anzahl der berlufe, der Zeitstempel die genaue Lage. Das
+// stimmt, solange eine Flanke weniger als einen halben berlauf (21ms) nach dem Erfassen
+// abgeholt wird.
+static uint32_t _loc_Elapsed(const tacho_t *t, uint16_t stamp, uint16_t tick)
+{
+	uint16_t p = stamp-t->Last;
+	uint16_t dt = tick-t->LastTick;
+	uint32_t Approx;
+	
+	if (dt<TACHO_GAP_TICKS/2) return p;
+	Approx=(uint32_t)dt*MESS_TICK_TOP;
+	if (Approx<=p) return p;
+	return p+((Approx-p+0x8000UL)&0xFFFF0000UL);
+}
+
+#ifdef TACHO_ESTIM
+// Alpha-Beta-Filter ber die Rohperioden, pro Impuls zwei Multiplikationen
+// Vorhersage P' = P + D, Residuum r = p - P', dann P = P' + alpha*r, D = D + beta*r.
+// Das Residuum wird auf 25% der Periode begrenzt, eine einzelne verlorene oder
+// doppelte Flanke verschiebt die Schtzung damit nur wenig.
+static void _loc_Estimate(tacho_t *t, uint16_t p)
+{
+	int32_t r, Lim;
+	
+	if (t->RawN<=1)
+	{
+		// Erste Periode nach dem Start: ohne Trend beginnen
+		t->EstP=(int32_t)p<<8;
+		t->EstD=0;
+		return;
+	}
+	
+	t->EstP+=t->EstD;
+	r=((int32_t)p<<8)-t->EstP;
+	Lim=t->EstP>>2;
+	if (r>Lim) r=Lim;
+	else if (r<-Lim) r=-Lim;
+	
+	t->EstP+=(r*TACHO_ALPHA_Q8)>>8;
+	t->EstD+=((r>>4)*TACHO_BETA_Q12)>>8;
+	
+	// Die Periode bleibt im messbaren Bereich, der Trend hchstens 25% pro Impuls
+	if (t->EstP<((int32_t)TACHO_MIN_PERIOD<<8)) t->EstP=(int32_t)TACHO_MIN_PERIOD<<8;
+	if (t->EstP>0xFFFF00L) t->EstP=0xFFFF00L;
+	Lim=t->EstP>>2;
+	if (t->EstD>Lim) t->EstD=Lim;
+	else if (t->EstD<-Lim) t->EstD=-Lim;
+}
+
+// Relative nderung der Periode pro Impuls D/P in Q16 (|D/P| <= 1/4)
+static int32_t _loc_Trend(const tacho_t *t)
+{
+	return (t->EstD<<8)/(t->EstP>>8);
+}
+
+uint16_t tacho_RpmEst(const tacho_t *t)
+{
+	if (!t->Run || (t->Rpm==0)) return 0;
+	// Langsamer Lauf (Perioden ber 16 Bit): keine Schtzung, nur die gemessene Drehzahl
+	if (t->EstP==0) return t->Rpm;
+	return (uint16_t)((MESS_K_PERIOD*16/(t->EstP>>8)+8)>>4);
+}
+
+uint16_t tacho_RpmNow(const tacho_t *t, uint16_t stamp, uint16_t tick)
+{
+	uint32_t E;
+	uint16_t Age;
+	int32_t P;
+	
+	if (!t->Run || (t->Rpm==0)) return 0;
+	
+	// Lnger als 16 Bit seit dem letzten Impuls oder langsamer Lauf ohne Schtzung:
+	// die Wartezeit begrenzt die Drehzahl nach oben, bis tacho_Check Stillstand meldet
+	E=_loc_Elapsed(t,stamp,tick);
+	if ((t->EstP==0) || (E>0xFFFF))
+	{
+		if (E>MESS_K_PERIOD/t->Rpm) return (uint16_t)((MESS_K_PERIOD+E/2)/E);
+		return t->Rpm;
+	}
+	Age=(uint16_t)E;
+	
+	// Seit dem letzten Impuls sind Age/P Impulse vergangen: P_jetzt = P + D*Age/P = P + (D/P)*Age
+	P=t->EstP+((_loc_Trend(t)*Age)>>8);
+	if (P<((int32_t)Age<<8)) P=(int32_t)Age<<8;
+	if (P<((int32_t)TACHO_MIN_PERIOD<<8)) P=(int32_t)TACHO_MIN_PERIOD<<8;
+	return (uint16_t)((MESS_K_PERIOD*16/(P>>8)+8)>>4);
+}
+
+int32_t tacho_Accel(const tacho_t *t)
+{
+	int32_t w, f, dw;
+	
+	if (!t->Run || (t->EstP==0) || (t->Rpm==0)) return 0;
+	
+	// dw/dt = dw/dn * Impulse pro Sekunde, dw/dn = -w * D/P
+	// w und f in Q4, die Zwischenwerte bleiben unter 2^31
+	w=MESS_K_PERIOD*16/(t->EstP>>8);
+	f=MESS_TIMER_HZ*16/(t->EstP>>8);
+	dw=-(((w>>2)*_loc_Trend(t))>>14);
+	return (dw*f)>>8;
+}
+#endif
+
+// Median von drei Werten
+static uint16_t _loc_Median3(uint16_t a, uint16_t b, uint16_t c)
+{
+	if (a>b) { uint16_t x=a; a=b; b=x; }
+	if (b>c) b=c;
+	return (a>b)?a:b;
+}
+
+uint16_t tacho_Period(const tacho_t *t)
+{
+	if (t->Fill==0) return 0;
+	if (t->Fill==TACHO_WINDOW) return (uint16_t)(t->Sum/TACHO_WINDOW);
+	return (uint16_t)(t->Sum/t->Fill);
+}
+
+uint8_t tacho_Edge(tacho_t *t, uint16_t stamp, uint16_t tick)
+{
+	uint32_t e;
+	uint16_t p, m;
+	
+	// Erste Flanke oder Stillstand: keine Periode, neu beginnen
+	if (!t->Run || ((uint16_t)(tick-t->LastTick)>=TACHO_STALL_TICKS))
+	{
+		_loc_Clear(t);
+		t->Run=1;
+		t->Rpm=0;
+		t->Last=stamp;
+		t->LastTick=tick;
+		return 0;
+	}
+	
+	// Periode lnger als 16 Bit (unter 60*MESS_TIMER_HZ/(65536*PPR) U/min): Drehzahl direkt
+	// aus dieser einen Periode, Median und Fenster beginnen neu, sobald es wieder schneller wird
+	e=_loc_Elapsed(t,stamp,tick);
+	if (e>0xFFFF)
+	{
+		_loc_Clear(t);
+		t->Last=stamp;
+		t->LastTick=tick;
+		t->Raw[2]=0xFFFF;
+		t->Rpm=(uint16_t)((MESS_K_PERIOD+e/2)/e);
+		return 1;
+	}
+	
+	// Prellen: die Flanke wird ignoriert, die Periode luft von der letzten gltigen weiter
+	p=(uint16_t)e;
+	if ((p<TACHO_MIN_PERIOD) || (p<(tacho_Period(t)>>2)))
+	{
+		t->Rejected++;
+		return 0;
+	}
+	t->Last=stamp;
+	t->LastTick=tick;
+	
+	// Median der letzten drei Perioden, bis dahin der Rohwert
+	t->Raw[0]=t->Raw[1];
+	t->Raw[1]=t->Raw[2];
+	t->Raw[2]=p;
+	if (t->RawN<3)
+	{
+		t->RawN++;
+		m=p;
+	}
+	else
+	{
+		m=_loc_Median3(t->Raw[0],t->Raw[1],p);
+		// Mehr als 25% vom Median entfernt: als Ausreisser zhlen
+		if ((p>m+(m>>2)) || (p<m-(m>>2))) t->Rejected++;
+	}
+	
+#ifdef TACHO_ESTIM
+	_loc_Estimate(t,p);
+#endif
+	
+	// Gleitende Summe: ltesten Wert ersetzen
+	t->Sum+=m;
+	t->Sum-=t->Win[t->Ix];
+	t->Win[t->Ix]=m;
+	t->Ix=(t->Ix+1)&(TACHO_WINDOW-1);
+	if (t->Fill<TACHO_WINDOW) t->Fill++;
+	
+	t->Rpm=(uint16_t)((MESS_K_PERIOD*t->Fill+t->Sum/2)/t->Sum);
+	return 1;
+}
+
+void tacho_InitAll(void)
+{
+	uint8_t b, i = 0;
+	
+	TACHO_DDR&=~(TACHO_MASK);
+	for (b=0;b<8;b++)
+	{
+		if (TACHO_MASK & (1<<b)) _loc_Bit[i++]=(1<<b);
+	}
+	for (i=0;i<TACHO_CHANNELS;i++) tacho_Init(&tacho_Ch[i]);
+	
+	// Eingnge, die schon high sind, erzeugen keine Flanke
+	_loc_Pins=TACHO_PIN & TACHO_MASK;
+}
+
+void tacho_Check(uint16_t tick)
+{
+	uint8_t i;
+	
+	// Stillstand je Kanal: nchste Flanke beginnt die Messung neu
+	for (i=0;i<TACHO_CHANNELS;i++)
+	{
+		if (tacho_Ch[i].Run && ((uint16_t)(tick-tacho_Ch[i].LastTick)>=TACHO_STALL_TICKS))
+		{
+			tacho_Ch[i].Run=0;
+			tacho_Ch[i].Rpm=0;
+		}
+	}
+}
+
+uint8_t tacho_Scan(uint16_t tick)
+{
+	uint8_t Pins, Rise, i, New = 0;
+	uint16_t Stamp;
+#ifdef SLOTMON
+	uint8_t Edge;
+#endif
+	
+	// Ein Lesezugriff fr alle Kanle, steigende Flanken per XOR
+	Pins=TACHO_PIN & TACHO_MASK;
+#ifdef SLOTMON
+	// Kanal 0 zustzlich mit beiden Flanken fr das Tastverhltnis
+	Edge=Pins^_loc_Pins;
+	Rise=Edge&Pins;
+	_loc_Pins=Pins;
+	
+	if (Edge)
+#else
+	Rise=(Pins^_loc_Pins)&Pins;
+	_loc_Pins=Pins;
+	
+	if (Rise)
+#endif
+	{
+		// Alle Flanken dieses Durchlaufs erhalten denselben Zeitstempel
+		Stamp=tacho_Stamp();
+#ifdef SLOTMON
+		if (Edge & _loc_Bit[0]) slotmon_Edge(Rise & _loc_Bit[0],Stamp,tick);
+#endif
+		for (i=0;i<TACHO_CHANNELS;i++)
+		{
+			if ((Rise & _loc_Bit[i]) && tacho_Edge(&tacho_Ch[i],Stamp,tick)) New|=(1<<i);
+		}
+	}
+	
+	tacho_Check(tick);
+	
+	_loc_Scans++;
+	if ((uint16_t)(tick-_loc_RateT0)>=TACHO_RATE_TICKS)
+	{
+		_loc_RateT0+=TACHO_RATE_TICKS;
+		_loc_Rate=_loc_Scans;
+		_loc_Scans=0;
+	}
+	return New;
+}
+
+uint32_t tacho_ScanRate(void)
+{
+	return _loc_Rate;
+}
+
+#endif
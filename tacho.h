@@ -0,0 +1,172 @@
+/************************************************************/
+/* Drehzahl aus den Perioden einzelner Impulse				*/
+/*															*/
+/* Jede Flanke der Lichtschranke liefert eine Periode in	*/
+/* Timer1-Ticks (1.5 MHz). Die Perioden laufen durch:		*/
+/*   1. Prellunterdrckung: zu kurze Perioden werden			*/
+/*      verworfen, die Flanke zhlt nicht					*/
+/*   2. Median aus den letzten 3 Perioden gegen einzelne		*/
+/*      Ausreisser (verlorene Flanke = doppelte Periode)		*/
+/*   3. gleitende Summe ber TACHO_WINDOW Perioden, pro		*/
+/*      Impuls wird nur ein Wert ersetzt (O(1))				*/
+/* Nach jedem Impuls steht eine neue Drehzahl bereit.		*/
+/*															*/
+/* Mehrere Lichtschranken (bis 8) an einem Port werden mit	*/
+/* tacho_Scan in einem Lesezugriff abgefragt, die Flanken	*/
+/* aller Kanle ergeben sich aus einem XOR mit dem			*/
+/* vorherigen Zustand. Jeder Kanal hat einen eigenen		*/
+/* Kontext (tacho_t), der Aufwand pro Kanal ist konstant.	*/
+/*															*/
+/* Mit #define TACHO_ESTIM luft pro Kanal zustzlich ein	*/
+/* Alpha-Beta-Filter ber die Rohperioden. Es schtzt die	*/
+/* Periode und ihre nderung pro Impuls; daraus folgen die	*/
+/* Beschleunigung und eine auf "jetzt" extrapolierte		*/
+/* Drehzahl, die bei Rampen nicht um ein Fenster nachluft.	*/
+/*															*/
+/* Aktiv nur mit #define TACHO								*/
+/************************************************************/
+
+#ifndef TACHO_H
+#define TACHO_H
+
+#include <stdint.h>
+#include <avr/io.h>
+#include <util/atomic.h>
+#include "messcfg.h"
+
+// Eingnge der Lichtschranken: Port und Bitmaske, Kanal 0 ist das niedrigste Bit
+#ifndef TACHO_PIN
+#define TACHO_PIN PIND
+#define TACHO_PIND		// Standardport, main.c prft dann auf berschneidungen
+#endif
+#ifndef TACHO_DDR
+#define TACHO_DDR DDRD
+#endif
+#ifndef TACHO_MASK
+#define TACHO_MASK (1<<PD7)
+#endif
+
+// Anzahl Kanle = Anzahl gesetzter Bits in TACHO_MASK
+#define TACHO_CHANNELS (((TACHO_MASK)&1)+(((TACHO_MASK)>>1)&1)+(((TACHO_MASK)>>2)&1)+(((TACHO_MASK)>>3)&1) \
+	+(((TACHO_MASK)>>4)&1)+(((TACHO_MASK)>>5)&1)+(((TACHO_MASK)>>6)&1)+(((TACHO_MASK)>>7)&1))
+
+// Lnge des gleitenden Fensters in Perioden, Zweierpotenz <= 64
+#ifndef TACHO_WINDOW
+#define TACHO_WINDOW 8
+#endif
+
+// Krzeste gltige Periode in Timer1-Ticks (Standard: 20000 U/min)
+#ifndef TACHO_MIN_PERIOD
+#define TACHO_MIN_PERIOD ((uint16_t)(MESS_K_PERIOD/20000UL))
+#endif
+
+#ifdef TACHO_ESTIM
+// Gewicht alpha des neuen Messwerts im Alpha-Beta-Filter in 1/256 (1..255), beta folgt
+// nach Benedict-Bordner aus alpha. Kleiner = ruhiger, grsser = schneller (64 = 0.25).
+#ifndef TACHO_ALPHA
+#define TACHO_ALPHA 64
+#endif
+#endif
+
+// Die 16 Bit Zeitstempel laufen nach 65536 Timer1-Ticks ber. Ab so vielen Abtast-Ticks (systick)
+// seit der letzten Flanke wird die Periode mit systick ber den berlauf hinweg verlngert,
+// messbar sind damit Perioden bis TACHO_STALL_TICKS.
+#ifndef TACHO_GAP_TICKS
+#define TACHO_GAP_TICKS ((uint16_t)(65535UL/MESS_TICK_TOP-1))
+#endif
+
+typedef struct
+{
+	uint16_t Last;					// Zeitstempel der letzten gltigen Flanke
+	uint16_t LastTick;				// systick der letzten gltigen Flanke
+	uint8_t Run;					// 1 sobald eine Flanke gesehen wurde
+	uint8_t RawN;					// Anzahl Werte in Raw (bis 3)
+	uint16_t Raw[3];				// letzte Perioden fr den Median
+	uint16_t Win[TACHO_WINDOW];		// gleitendes Fenster der gefilterten Perioden
+	uint8_t Ix;						// nchster zu ersetzender Platz in Win
+	uint8_t Fill;					// Anzahl gltiger Werte in Win
+	uint32_t Sum;					// Summe ber Win
+	uint16_t Rpm;					// zuletzt berechnete Drehzahl
+	uint16_t Rejected;				// verworfene Flanken und Ausreisser (> 25% vom Median)
+#ifdef TACHO_ESTIM
+	int32_t EstP;					// geschtzte Periode in 1/256 Timer1-Ticks
+	int32_t EstD;					// geschtzte nderung der Periode pro Impuls, 1/256 Ticks
+#endif
+} tacho_t;
+
+// Zeitstempel fr tacho_Edge: TCNT1 luft frei, das 16 Bit Lesen muss atomar sein
+static inline uint16_t tacho_Stamp(void)
+{
+	uint16_t t;
+	
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		t = TCNT1;
+	}
+	return t;
+}
+
+// Ohne Impuls whrend MESS_STALL_TICKS fllt die Drehzahl eines Kanals auf 0
+#ifndef TACHO_STALL_TICKS
+#define TACHO_STALL_TICKS MESS_STALL_TICKS
+#endif
+
+// Kontexte der Kanle, Index 0..TACHO_CHANNELS-1
+extern tacho_t tacho_Ch[TACHO_CHANNELS];
+
+// Kanal zurcksetzen
+void tacho_Init(tacho_t *t);
+
+// Alle Kanle zurcksetzen und die Eingnge konfigurieren
+void tacho_InitAll(void);
+
+// Alle Eingnge mit einem Lesezugriff abfragen und die steigenden Flanken auswerten,
+// so oft wie mglich aus der Hauptschleife aufrufen (tick = systick)
+// Kanle ohne Impuls seit TACHO_STALL_TICKS werden auf 0 U/min gesetzt.
+// Rckgabe: Bit n gesetzt, wenn Kanal n eine neue Drehzahl berechnet hat
+uint8_t tacho_Scan(uint16_t tick);
+
+// Nur die Stillstandsprfung aller Kanle (wird von tacho_Scan mit erledigt),
+// fr Betriebsarten, in denen die Flanken nicht ber tacho_Scan kommen
+void tacho_Check(uint16_t tick);
+
+// Abfragen pro Sekunde in der letzten vollen Sekunde.
+// Alle Kanle werden bei jedem Aufruf von tacho_Scan gelesen,
+// das ist damit auch die Abtastrate jedes einzelnen Kanals.
+uint32_t tacho_ScanRate(void);
+
+// Eine Flanke bergeben (stamp = tacho_Stamp(), tick = systick)
+// Rckgabe: 1 wenn eine neue Drehzahl berechnet wurde
+uint8_t tacho_Edge(tacho_t *t, uint16_t stamp, uint16_t tick);
+
+// Zuletzt berechnete Drehzahl in U/min
+static inline uint16_t tacho_Rpm(const tacho_t *t)
+{
+	return t->Rpm;
+}
+
+// Mittlere gefilterte Periode in Timer1-Ticks, 0 solange keine vorliegt
+uint16_t tacho_Period(const tacho_t *t);
+
+#ifdef TACHO_ESTIM
+// Auf den Zeitpunkt stamp (tacho_Stamp(), tick = systick) extrapolierte Drehzahl in U/min
+// Seit dem letzten Impuls wird die geschtzte Periodennderung fortgeschrieben. Ist schon
+// lnger kein Impuls gekommen als die Periode lang ist, gilt die Wartezeit als Periode,
+// die Drehzahl fllt dann bis zum Stillstand stetig ab.
+uint16_t tacho_RpmNow(const tacho_t *t, uint16_t stamp, uint16_t tick);
+
+// Geschtzte Drehzahl zum Zeitpunkt des letzten Impulses in U/min
+uint16_t tacho_RpmEst(const tacho_t *t);
+
+// Geschtzte Beschleunigung in U/min pro Sekunde
+int32_t tacho_Accel(const tacho_t *t);
+#endif
+
+// Ungefilterte Periode des letzten gltigen Impulses (vor Median und Fenster),
+// gltig direkt nachdem tacho_Edge 1 geliefert hat, 0xFFFF bei Perioden ber 16 Bit
+static inline uint16_t tacho_RawPeriod(const tacho_t *t)
+{
+	return t->Raw[2];
+}
+
+#endif
@@ -0,0 +1,210 @@
+/************************************************************/
+/* Implementierung von telemetry.h							*/
+/*															*/
+/************************************************************/
+
+#ifdef TELEMETRY
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include "telemetry.h"
+
+#if (TELEMETRY_BUFSIZE & (TELEMETRY_BUFSIZE-1)) || (TELEMETRY_BUFSIZE > 128)
+#error "TELEMETRY_BUFSIZE muss eine Zweierpotenz <= 128 sein"
+#endif
+#define TELEMETRY_MASK (TELEMETRY_BUFSIZE-1)
+
+// Baudratenregister, gerundet
+#define TELEMETRY_UBRR ((F_CPU+8UL*TELEMETRY_BAUD)/(16UL*TELEMETRY_BAUD)-1)
+
+// Ringpuffer: Head wird nur vom Hauptprogramm, Tail nur von der ISR verndert
+static uint8_t _loc_Buf[TELEMETRY_BUFSIZE];
+static volatile uint8_t _loc_Head = 0;
+static volatile uint8_t _loc_Tail = 0;
+
+static uint8_t _loc_Seq = 0;
+static uint8_t _loc_Div = 1;
+static uint8_t _loc_DivCnt = 0;
+static uint16_t _loc_Drops = 0;
+
+void telemetry_Init(void)
+{
+	UBRRH=(uint8_t)(TELEMETRY_UBRR>>8);
+	UBRRL=(uint8_t)TELEMETRY_UBRR;
+	UCSRC=(1<<URSEL)|(1<<UCSZ1)|(1<<UCSZ0);
+	UCSRB=(1<<TXEN);
+}
+
+void telemetry_SetDivider(uint8_t n)
+{
+	_loc_Div=n?n:1;
+	_loc_DivCnt=0;
+}
+
+uint8_t telemetry_Send(uint8_t type, const uint8_t *data, uint8_t len)
+{
+	uint8_t Frame[TELFRAME_MAX];
+	uint8_t n, i, Head;
+	
+	n=telframe_Pack(Frame,type,_loc_Seq,data,len);
+	
+	// Platz prfen, ein Byte bleibt frei um voll und leer zu unterscheiden
+	Head=_loc_Head;
+	if (((_loc_Tail-Head-1) & TELEMETRY_MASK)<n)
+	{
+		_loc_Drops++;
+		return 0;
+	}
+	
+	// Die Sequenznummer zhlt nur gesendete Rahmen, Lcken beim Host
+	// bedeuten damit Verluste auf der Leitung
+	_loc_Seq++;
+	for (i=0;i<n;i++)
+	{
+		_loc_Buf[Head]=Frame[i];
+		Head=(Head+1) & TELEMETRY_MASK;
+	}
+	_loc_Head=Head;
+	
+	// Sende-Interrupt freigeben, die ISR sperrt ihn wieder wenn der Puffer leer ist
+	UCSRB|=(1<<UDRIE);
+	return 1;
+}
+
+void telemetry_Mess(uint16_t rpm, uint16_t period, uint16_t soll, uint8_t duty, int16_t accel)
+{
+	telframe_mess_t m;
+	uint8_t Data[TELFRAME_MESS_LEN];
+	
+	if (++_loc_DivCnt<_loc_Div) return;
+	_loc_DivCnt=0;
+	
+	m.Rpm=rpm;
+	m.Period=period;
+	m.Soll=soll;
+	m.Duty=duty;
+	m.Accel=accel;
+	telframe_PutMess(Data,&m);
+	telemetry_Send(TELFRAME_TYPE_MESS,Data,TELFRAME_MESS_LEN);
+}
+
+void telemetry_Status(uint16_t stackfree)
+{
+	telframe_status_t st;
+	uint8_t Data[TELFRAME_STATUS_LEN];
+	
+	st.Drops=_loc_Drops;
+	st.StackFree=stackfree;
+	telframe_PutStatus(Data,&st);
+	telemetry_Send(TELFRAME_TYPE_STATUS,Data,TELFRAME_STATUS_LEN);
+}
+
+void telemetry_Power(uint16_t wakes, uint16_t permille)
+{
+	telframe_power_t p;
+	uint8_t Data[TELFRAME_POWER_LEN];
+	
+	p.Wakes=wakes;
+	p.Sleep=permille;
+	telframe_PutPower(Data,&p);
+	telemetry_Send(TELFRAME_TYPE_POWER,Data,TELFRAME_POWER_LEN);
+}
+
+void telemetry_Vibra(uint8_t harm, uint16_t amp, uint16_t phase, uint16_t mean)
+{
+	telframe_vibra_t v;
+	uint8_t Data[TELFRAME_VIBRA_LEN];
+	
+	v.Harm=harm;
+	v.Amp=amp;
+	v.Phase=phase;
+	v.Mean=mean;
+	telframe_PutVibra(Data,&v);
+	telemetry_Send(TELFRAME_TYPE_VIBRA,Data,TELFRAME_VIBRA_LEN);
+}
+
+void telemetry_Slot(uint8_t slot, uint8_t flags, uint16_t duty, uint16_t min, uint16_t max, uint16_t glitches)
+{
+	telframe_slot_t sl;
+	uint8_t Data[TELFRAME_SLOT_LEN];
+	
+	sl.Slot=slot;
+	sl.Flags=flags;
+	sl.Duty=duty;
+	sl.Min=min;
+	sl.Max=max;
+	sl.Glitches=glitches;
+	telframe_PutSlot(Data,&sl);
+	telemetry_Send(TELFRAME_TYPE_SLOT,Data,TELFRAME_SLOT_LEN);
+}
+
+uint8_t telemetry_Trace(const telframe_trace_t *tr)
+{
+	uint8_t Data[TELFRAME_TRACE_LEN];
+	
+	// Nur senden, wenn Platz ist: der Ausschnitt wird spter wiederholt und nicht als verworfen gezhlt
+	if (((_loc_Tail-_loc_Head-1) & TELEMETRY_MASK)<TELFRAME_HEADER+TELFRAME_TRACE_LEN+TELFRAME_CRC) return 0;
+	telframe_PutTrace(Data,tr);
+	return telemetry_Send(TELFRAME_TYPE_TRACE,Data,TELFRAME_TRACE_LEN);
+}
+
+void telemetry_Quad(int32_t pos, uint16_t errors, uint16_t steps, int8_t dir)
+{
+	telframe_quad_t q;
+	uint8_t Data[TELFRAME_QUAD_LEN];
+	
+	q.Position=pos;
+	q.Errors=errors;
+	q.StepsPerRev=steps;
+	q.Dir=dir;
+	telframe_PutQuad(Data,&q);
+	telemetry_Send(TELFRAME_TYPE_QUAD,Data,TELFRAME_QUAD_LEN);
+}
+
+void telemetry_Isr(uint8_t ch, uint16_t cnt, uint16_t latmax, uint16_t exemax, uint16_t over, uint16_t budget)
+{
+	telframe_isr_t is;
+	uint8_t Data[TELFRAME_ISR_LEN];
+	
+	is.Ch=ch;
+	is.Cnt=cnt;
+	is.LatMax=latmax;
+	is.ExeMax=exemax;
+	is.Over=over;
+	is.Budget=budget;
+	telframe_PutIsr(Data,&is);
+	telemetry_Send(TELFRAME_TYPE_ISR,Data,TELFRAME_ISR_LEN);
+}
+
+uint8_t telemetry_Boot(const telframe_boot_t *b)
+{
+	uint8_t Data[TELFRAME_BOOT_LEN];
+	
+	// Wird nur einmal gesendet: bei vollem Puffer nicht verwerfen, sondern spter wiederholen
+	if (((_loc_Tail-_loc_Head-1) & TELEMETRY_MASK)<TELFRAME_HEADER+TELFRAME_BOOT_LEN+TELFRAME_CRC) return 0;
+	telframe_PutBoot(Data,b);
+	return telemetry_Send(TELFRAME_TYPE_BOOT,Data,TELFRAME_BOOT_LEN);
+}
+
+uint16_t telemetry_Drops(void)
+{
+	return _loc_Drops;
+}
+
+// Datenregister leer: nchstes Byte senden
+ISR(USART_UDRE_vect)
+{
+	uint8_t Tail = _loc_Tail;
+	
+	if (Tail!=_loc_Head)
+	{
+		UDR=_loc_Buf[Tail];
+		_loc_Tail=(Tail+1) & TELEMETRY_MASK;
+	}
+	else
+	{
+		UCSRB&=~(1<<UDRIE);
+	}
+}
+
+#endif
@@ -0,0 +1,72 @@
+/************************************************************/
+/* Telemetrie ber die USART (nur Senden)					*/
+/*															*/
+/* Die Rahmen (siehe telframe.h) werden in einen Ringpuffer	*/
+/* geschrieben, den der UDRE-Interrupt im Hintergrund		*/
+/* leert. Ist der Puffer voll, wird der Rahmen verworfen	*/
+/* und gezhlt - die Hauptschleife wartet nie auf den Host.	*/
+/*															*/
+/* Aktiv nur mit #define TELEMETRY							*/
+/************************************************************/
+
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdint.h>
+#include "telframe.h"
+
+// Baudrate, 57600 hat bei 12 MHz einen Fehler von 0.16%
+#ifndef TELEMETRY_BAUD
+#define TELEMETRY_BAUD 57600UL
+#endif
+
+// Grsse des Sendepuffers, muss eine Zweierpotenz <= 128 sein
+#ifndef TELEMETRY_BUFSIZE
+#define TELEMETRY_BUFSIZE 64
+#endif
+
+// USART initialisieren (8N1, nur Sender)
+void telemetry_Init(void);
+
+// Nur jeden n-ten Messwert senden (1 = jeden, Standard)
+void telemetry_SetDivider(uint8_t n);
+
+// Einen Messwert bergeben, gesendet wird entsprechend dem Teiler
+// accel: Beschleunigung in U/min pro Sekunde, 0 wenn nicht bekannt
+void telemetry_Mess(uint16_t rpm, uint16_t period, uint16_t soll, uint8_t duty, int16_t accel);
+
+// Einen Status-Rahmen mit dem Zhler der verworfenen Rahmen senden
+// stackfree: Stack-Reserve in Bytes oder 0xFFFF
+void telemetry_Status(uint16_t stackfree);
+
+// Schlafstatistik senden (Aufwachvorgnge pro Sekunde, geschlafener Anteil in Promille)
+void telemetry_Power(uint16_t wakes, uint16_t permille);
+
+// Ergebnis eines Schwingungsfilters senden (siehe vibra.h)
+void telemetry_Vibra(uint8_t harm, uint16_t amp, uint16_t phase, uint16_t mean);
+
+// Tastverhltnis eines Schlitzes und Warnbits der Lichtschranke senden (siehe slotmon.h)
+void telemetry_Slot(uint8_t slot, uint8_t flags, uint16_t duty, uint16_t min, uint16_t max, uint16_t glitches);
+
+// Ausschnitt des Flugschreibers senden (siehe trace.h)
+// Rckgabe: 0 wenn gerade kein Platz im Sendepuffer ist, dann spter wiederholen
+uint8_t telemetry_Trace(const telframe_trace_t *tr);
+
+// Position, Fehlerzhler und Richtung des Drehgebers senden (siehe quad.h)
+void telemetry_Quad(int32_t pos, uint16_t errors, uint16_t steps, int8_t dir);
+
+// Laufzeit einer ISR senden (Kanal und Statistik des Profilers, siehe isrprof.h)
+void telemetry_Isr(uint8_t ch, uint16_t cnt, uint16_t latmax, uint16_t exemax, uint16_t over, uint16_t budget);
+
+// Init-Zeiten einer Anzeige senden (siehe display_InitStageTime)
+// Rckgabe: 0 wenn gerade kein Platz im Sendepuffer ist, dann spter wiederholen
+uint8_t telemetry_Boot(const telframe_boot_t *b);
+
+// Einen beliebigen Rahmen in den Sendepuffer stellen
+// Rckgabe: 0 wenn der Rahmen mangels Platz verworfen wurde
+uint8_t telemetry_Send(uint8_t type, const uint8_t *data, uint8_t len);
+
+// Anzahl der bisher verworfenen Rahmen
+uint16_t telemetry_Drops(void);
+
+#endif
@@ -0,0 +1,258 @@
+/************************************************************/
+/* Implementierung von telframe.h							*/
+/*															*/
+/************************************************************/
+
+#include "telframe.h"
+
+#ifdef __AVR__
+#include <util/crc16.h>
+#endif
+
+uint16_t telframe_Crc(uint16_t crc, uint8_t data)
+{
+#ifdef __AVR__
+	return _crc_xmodem_update(crc,data);
+#else
+	// Gleichwertige C-Implementierung aus der avr-libc Dokumentation
+	uint8_t i;
+	
+	crc=crc^((uint16_t)data<<8);
+	for (i=0;i<8;i++)
+	{
+		if (crc&0x8000) crc=(crc<<1)^0x1021;
+		else crc<<=1;
+	}
+	return crc;
+#endif
+}
+
+uint8_t telframe_Pack(uint8_t *buf, uint8_t type, uint8_t seq, const uint8_t *data, uint8_t len)
+{
+	uint16_t crc = 0;
+	uint8_t n, i;
+	
+	if (len>TELFRAME_MAX_DATA) len=TELFRAME_MAX_DATA;
+	
+	buf[0]=TELFRAME_SYNC;
+	buf[1]=type;
+	buf[2]=len;
+	buf[3]=seq;
+	n=TELFRAME_HEADER;
+	for (i=0;i<len;i++)
+	{
+		buf[n++]=data[i];
+	}
+	for (i=1;i<n;i++)
+	{
+		crc=telframe_Crc(crc,buf[i]);
+	}
+	buf[n++]=crc&0xFF;
+	buf[n++]=crc>>8;
+	
+	return n;
+}
+
+void telframe_PutMess(uint8_t *data, const telframe_mess_t *m)
+{
+	data[0]=m->Rpm&0xFF;
+	data[1]=m->Rpm>>8;
+	data[2]=m->Period&0xFF;
+	data[3]=m->Period>>8;
+	data[4]=m->Soll&0xFF;
+	data[5]=m->Soll>>8;
+	data[6]=m->Duty;
+	data[7]=(uint16_t)m->Accel&0xFF;
+	data[8]=(uint16_t)m->Accel>>8;
+}
+
+void telframe_GetMess(telframe_mess_t *m, const uint8_t *data)
+{
+	m->Rpm=data[0]|((uint16_t)data[1]<<8);
+	m->Period=data[2]|((uint16_t)data[3]<<8);
+	m->Soll=data[4]|((uint16_t)data[5]<<8);
+	m->Duty=data[6];
+	m->Accel=(int16_t)(data[7]|((uint16_t)data[8]<<8));
+}
+
+void telframe_PutStatus(uint8_t *data, const telframe_status_t *st)
+{
+	data[0]=st->Drops&0xFF;
+	data[1]=st->Drops>>8;
+	data[2]=st->StackFree&0xFF;
+	data[3]=st->StackFree>>8;
+}
+
+void telframe_GetStatus(telframe_status_t *st, const uint8_t *data)
+{
+	st->Drops=data[0]|((uint16_t)data[1]<<8);
+	st->StackFree=data[2]|((uint16_t)data[3]<<8);
+}
+
+void telframe_PutPower(uint8_t *data, const telframe_power_t *p)
+{
+	data[0]=p->Wakes&0xFF;
+	data[1]=p->Wakes>>8;
+	data[2]=p->Sleep&0xFF;
+	data[3]=p->Sleep>>8;
+}
+
+void telframe_GetPower(telframe_power_t *p, const uint8_t *data)
+{
+	p->Wakes=data[0]|((uint16_t)data[1]<<8);
+	p->Sleep=data[2]|((uint16_t)data[3]<<8);
+}
+
+void telframe_PutVibra(uint8_t *data, const telframe_vibra_t *v)
+{
+	data[0]=v->Harm;
+	data[1]=v->Amp&0xFF;
+	data[2]=v->Amp>>8;
+	data[3]=v->Phase&0xFF;
+	data[4]=v->Phase>>8;
+	data[5]=v->Mean&0xFF;
+	data[6]=v->Mean>>8;
+}
+
+void telframe_GetVibra(telframe_vibra_t *v, const uint8_t *data)
+{
+	v->Harm=data[0];
+	v->Amp=data[1]|((uint16_t)data[2]<<8);
+	v->Phase=data[3]|((uint16_t)data[4]<<8);
+	v->Mean=data[5]|((uint16_t)data[6]<<8);
+}
+
+void telframe_PutSlot(uint8_t *data, const telframe_slot_t *sl)
+{
+	data[0]=sl->Slot;
+	data[1]=sl->Flags;
+	data[2]=sl->Duty&0xFF;
+	data[3]=sl->Duty>>8;
+	data[4]=sl->Min&0xFF;
+	data[5]=sl->Min>>8;
+	data[6]=sl->Max&0xFF;
+	data[7]=sl->Max>>8;
+	data[8]=sl->Glitches&0xFF;
+	data[9]=sl->Glitches>>8;
+}
+
+void telframe_GetSlot(telframe_slot_t *sl, const uint8_t *data)
+{
+	sl->Slot=data[0];
+	sl->Flags=data[1];
+	sl->Duty=data[2]|((uint16_t)data[3]<<8);
+	sl->Min=data[4]|((uint16_t)data[5]<<8);
+	sl->Max=data[6]|((uint16_t)data[7]<<8);
+	sl->Glitches=data[8]|((uint16_t)data[9]<<8);
+}
+
+void telframe_PutTrace(uint8_t *data, const telframe_trace_t *tr)
+{
+	uint8_t i;
+	
+	data[0]=tr->First;
+	data[1]=tr->Total;
+	data[2]=tr->TickTop&0xFF;
+	data[3]=tr->TickTop>>8;
+	for (i=0;i<TELFRAME_TRACE_EVENTS;i++)
+	{
+		data[4+6*i]=tr->Ev[i].Id;
+		data[5+6*i]=tr->Ev[i].Arg;
+		data[6+6*i]=tr->Ev[i].Tick&0xFF;
+		data[7+6*i]=tr->Ev[i].Tick>>8;
+		data[8+6*i]=tr->Ev[i].Time&0xFF;
+		data[9+6*i]=tr->Ev[i].Time>>8;
+	}
+}
+
+void telframe_GetTrace(telframe_trace_t *tr, const uint8_t *data)
+{
+	uint8_t i;
+	
+	tr->First=data[0];
+	tr->Total=data[1];
+	tr->TickTop=data[2]|((uint16_t)data[3]<<8);
+	for (i=0;i<TELFRAME_TRACE_EVENTS;i++)
+	{
+		tr->Ev[i].Id=data[4+6*i];
+		tr->Ev[i].Arg=data[5+6*i];
+		tr->Ev[i].Tick=data[6+6*i]|((uint16_t)data[7+6*i]<<8);
+		tr->Ev[i].Time=data[8+6*i]|((uint16_t)data[9+6*i]<<8);
+	}
+}
+
+void telframe_PutQuad(uint8_t *data, const telframe_quad_t *q)
+{
+	uint32_t p = (uint32_t)q->Position;
+	
+	data[0]=p&0xFF;
+	data[1]=(p>>8)&0xFF;
+	data[2]=(p>>16)&0xFF;
+	data[3]=p>>24;
+	data[4]=q->Errors&0xFF;
+	data[5]=q->Errors>>8;
+	data[6]=q->StepsPerRev&0xFF;
+	data[7]=q->StepsPerRev>>8;
+	data[8]=(uint8_t)q->Dir;
+}
+
+void telframe_GetQuad(telframe_quad_t *q, const uint8_t *data)
+{
+	q->Position=(int32_t)(data[0]|((uint32_t)data[1]<<8)|((uint32_t)data[2]<<16)|((uint32_t)data[3]<<24));
+	q->Errors=data[4]|((uint16_t)data[5]<<8);
+	q->StepsPerRev=data[6]|((uint16_t)data[7]<<8);
+	q->Dir=(int8_t)data[8];
+}
+
+void telframe_PutIsr(uint8_t *data, const telframe_isr_t *is)
+{
+	data[0]=is->Ch;
+	data[1]=is->Cnt&0xFF;
+	data[2]=is->Cnt>>8;
+	data[3]=is->LatMax&0xFF;
+	data[4]=is->LatMax>>8;
+	data[5]=is->ExeMax&0xFF;
+	data[6]=is->ExeMax>>8;
+	data[7]=is->Over&0xFF;
+	data[8]=is->Over>>8;
+	data[9]=is->Budget&0xFF;
+	data[10]=is->Budget>>8;
+}
+
+void telframe_GetIsr(telframe_isr_t *is, const uint8_t *data)
+{
+	is->Ch=data[0];
+	is->Cnt=data[1]|((uint16_t)data[2]<<8);
+	is->LatMax=data[3]|((uint16_t)data[4]<<8);
+	is->ExeMax=data[5]|((uint16_t)data[6]<<8);
+	is->Over=data[7]|((uint16_t)data[8]<<8);
+	is->Budget=data[9]|((uint16_t)data[10]<<8);
+}
+
+void telframe_PutBoot(uint8_t *data, const telframe_boot_t *b)
+{
+	uint8_t i;
+	
+	data[0]=b->Disp;
+	data[1]=b->First;
+	data[2]=b->TickUs&0xFF;
+	data[3]=b->TickUs>>8;
+	for (i=0;i<TELFRAME_BOOT_STAGES;i++)
+	{
+		data[4+2*i]=b->Time[i]&0xFF;
+		data[5+2*i]=b->Time[i]>>8;
+	}
+}
+
+void telframe_GetBoot(telframe_boot_t *b, const uint8_t *data)
+{
+	uint8_t i;
+	
+	b->Disp=data[0];
+	b->First=data[1];
+	b->TickUs=data[2]|((uint16_t)data[3]<<8);
+	for (i=0;i<TELFRAME_BOOT_STAGES;i++)
+	{
+		b->Time[i]=data[4+2*i]|((uint16_t)data[5+2*i]<<8);
+	}
+}
@@ -0,0 +1,164 @@
+/************************************************************/
+/* Rahmenformat fr die Telemetrie ber die serielle		*/
+/* Schnittstelle. Ohne AVR-Abhngigkeiten, wird auch vom	*/
+/* Host-Decoder (tools/teldecode.c) verwendet.				*/
+/*															*/
+/* Aufbau eines Rahmens (Mehrbyte-Werte little endian):		*/
+/*   SYNC(0xA5) TYP LEN SEQ NUTZDATEN[LEN] CRC16			*/
+/* Die CRC (CRC-16/XMODEM, Polynom 0x1021, Start 0) luft	*/
+/* ber TYP, LEN, SEQ und die Nutzdaten.					*/
+/************************************************************/
+
+#ifndef TELFRAME_H
+#define TELFRAME_H
+
+#include <stdint.h>
+
+#define TELFRAME_SYNC		0xA5
+#define TELFRAME_HEADER		4		// SYNC, TYP, LEN, SEQ
+#define TELFRAME_CRC		2
+#define TELFRAME_MAX_DATA	16
+#define TELFRAME_MAX		(TELFRAME_HEADER+TELFRAME_MAX_DATA+TELFRAME_CRC)
+
+// Rahmentypen
+#define TELFRAME_TYPE_MESS		1	// Messwert, siehe telframe_mess_t
+#define TELFRAME_TYPE_STATUS	2	// Zustand des Senders, siehe telframe_status_t
+#define TELFRAME_TYPE_POWER		3	// Schlafstatistik, siehe telframe_power_t
+#define TELFRAME_TYPE_VIBRA		4	// Schwingungsanalyse, siehe telframe_vibra_t
+#define TELFRAME_TYPE_SLOT		5	// Tastverhltnis eines Schlitzes, siehe telframe_slot_t
+#define TELFRAME_TYPE_TRACE		6	// Ausschnitt des Flugschreibers, siehe telframe_trace_t
+#define TELFRAME_TYPE_QUAD		7	// Position des Drehgebers, siehe telframe_quad_t
+#define TELFRAME_TYPE_ISR		8	// Laufzeit einer ISR, siehe telframe_isr_t
+#define TELFRAME_TYPE_BOOT		9	// Init-Zeiten einer Anzeige, siehe telframe_boot_t
+
+// Nutzdaten eines Messwert-Rahmens (9 Bytes)
+typedef struct
+{
+	uint16_t Rpm;		// Drehzahl in U/min
+	uint16_t Period;	// Rohwert der Periodenmessung in Timer-Ticks
+	uint16_t Soll;		// Sollwert in U/min
+	uint8_t Duty;		// PWM Tastverhltnis (OCR0)
+	int16_t Accel;		// Beschleunigung in U/min pro Sekunde (gesttigt), 0 ohne TACHO_ESTIM
+} telframe_mess_t;
+#define TELFRAME_MESS_LEN 9
+
+// Nutzdaten eines Status-Rahmens (4 Bytes)
+typedef struct
+{
+	uint16_t Drops;		// Anzahl verworfener Rahmen (Sendepuffer voll)
+	uint16_t StackFree;	// kleinste Stack-Reserve in Bytes, 0xFFFF = unbekannt
+} telframe_status_t;
+#define TELFRAME_STATUS_LEN 4
+
+// Nutzdaten eines Schlafstatistik-Rahmens (4 Bytes), je Sekunde
+typedef struct
+{
+	uint16_t Wakes;		// Aufwachvorgnge pro Sekunde
+	uint16_t Sleep;		// geschlafener Anteil in Promille
+} telframe_power_t;
+#define TELFRAME_POWER_LEN 4
+
+// Nutzdaten eines Schwingungs-Rahmens (7 Bytes), je Block und Filter
+typedef struct
+{
+	uint8_t Harm;		// Harmonische der Drehfrequenz
+	uint16_t Amp;		// Amplitude der Periodenschwankung in 1/16 Timer-Ticks
+	uint16_t Phase;		// Phase in Grad
+	uint16_t Mean;		// mittlere Periode des Blocks in Timer-Ticks
+} telframe_vibra_t;
+#define TELFRAME_VIBRA_LEN 7
+
+// Nutzdaten eines Schlitz-Rahmens (10 Bytes), je Block ein Schlitz reihum
+typedef struct
+{
+	uint8_t Slot;		// Schlitz der Geberscheibe (0..PPR-1)
+	uint8_t Flags;		// Warnbits der Lichtschranke (SLOTMON_LOW...)
+	uint16_t Duty;		// mittleres Tastverhltnis in Promille
+	uint16_t Min;		// kleinstes Tastverhltnis in Promille
+	uint16_t Max;		// grsstes Tastverhltnis in Promille
+	uint16_t Glitches;	// Strimpulse seit dem Start
+} telframe_slot_t;
+#define TELFRAME_SLOT_LEN 10
+
+// Ein Ereignis des Flugschreibers (siehe trace.h)
+typedef struct
+{
+	uint8_t Id;			// Ereignis, 0 = leer
+	uint8_t Arg;		// Zusatzwert
+	uint16_t Tick;		// Abtast-Tick (systick)
+	uint16_t Time;		// Timer1
+} telframe_event_t;
+#define TELFRAME_TRACE_EVENTS 2
+
+// Nutzdaten eines Flugschreiber-Rahmens (16 Bytes), der Puffer kommt in Stcken
+typedef struct
+{
+	uint8_t First;		// Index des ersten Ereignisses (0 = ltestes)
+	uint8_t Total;		// Anzahl Ereignisse im Puffer
+	uint16_t TickTop;	// Timer1-Ticks pro Abtast-Tick
+	telframe_event_t Ev[TELFRAME_TRACE_EVENTS];
+} telframe_trace_t;
+#define TELFRAME_TRACE_LEN 16
+
+// Nutzdaten eines Drehgeber-Rahmens (9 Bytes), je Block
+typedef struct
+{
+	int32_t Position;		// Position in Schritten (vorwrts positiv)
+	uint16_t Errors;		// ungltige bergnge (verlorene Flanken)
+	uint16_t StepsPerRev;	// Schritte pro Umdrehung
+	int8_t Dir;				// Richtung des letzten Schritts: 1, -1, 0
+} telframe_quad_t;
+#define TELFRAME_QUAD_LEN 9
+
+// Nutzdaten eines ISR-Rahmens (11 Bytes), je Kanal des Profilers (siehe isrprof.h)
+typedef struct
+{
+	uint8_t Ch;			// Kanal (ISRPROF_CH_...)
+	uint16_t Cnt;		// Anzahl Aufrufe, bleibt bei 0xFFFF stehen
+	uint16_t LatMax;	// grsste Latenz in Timer1-Ticks
+	uint16_t ExeMax;	// grsste Ausfhrungszeit in Timer1-Ticks
+	uint16_t Over;		// Latenzen ber dem Budget
+	uint16_t Budget;	// Latenz-Budget in Timer1-Ticks
+} telframe_isr_t;
+#define TELFRAME_ISR_LEN 11
+
+// Nutzdaten eines Boot-Rahmens (16 Bytes), einmal nach der Initialisierung einer Anzeige
+// Die Init-Schritte kommen in Stcken zu TELFRAME_BOOT_STAGES
+#define TELFRAME_BOOT_STAGES 6
+typedef struct
+{
+	uint8_t Disp;		// Anzeige (0 = Hauptanzeige, 1 = Detailseite)
+	uint8_t First;		// Nummer des ersten Init-Schritts
+	uint16_t TickUs;	// Dauer eines Ticks in us (DISP_TICK_US)
+	uint16_t Time[TELFRAME_BOOT_STAGES];	// Ticks seit display_InitStart, 0xFFFF = nicht ausgefhrt
+} telframe_boot_t;
+#define TELFRAME_BOOT_LEN 16
+
+// CRC-16/XMODEM um ein Byte weiterrechnen
+uint16_t telframe_Crc(uint16_t crc, uint8_t data);
+
+// Einen kompletten Rahmen in buf aufbauen (buf muss TELFRAME_MAX Bytes fassen)
+// Rckgabe: Lnge des Rahmens in Bytes
+uint8_t telframe_Pack(uint8_t *buf, uint8_t type, uint8_t seq, const uint8_t *data, uint8_t len);
+
+// Nutzdaten in die Bytefolge des Rahmens umsetzen bzw. zurck
+void telframe_PutMess(uint8_t *data, const telframe_mess_t *m);
+void telframe_GetMess(telframe_mess_t *m, const uint8_t *data);
+void telframe_PutStatus(uint8_t *data, const telframe_status_t *st);
+void telframe_GetStatus(telframe_status_t *st, const uint8_t *data);
+void telframe_PutPower(uint8_t *data, const telframe_power_t *p);
+void telframe_GetPower(telframe_power_t *p, const uint8_t *data);
+void telframe_PutVibra(uint8_t *data, const telframe_vibra_t *v);
+void telframe_GetVibra(telframe_vibra_t *v, const uint8_t *data);
+void telframe_PutSlot(uint8_t *data, const telframe_slot_t *sl);
+void telframe_GetSlot(telframe_slot_t *sl, const uint8_t *data);
+void telframe_PutTrace(uint8_t *data, const telframe_trace_t *tr);
+void telframe_GetTrace(telframe_trace_t *tr, const uint8_t *data);
+void telframe_PutQuad(uint8_t *data, const telframe_quad_t *q);
+void telframe_GetQuad(telframe_quad_t *q, const uint8_t *data);
+void telframe_PutIsr(uint8_t *data, const telframe_isr_t *is);
+void telframe_GetIsr(telframe_isr_t *is, const uint8_t *data);
+void telframe_PutBoot(uint8_t *data, const telframe_boot_t *b);
+void telframe_GetBoot(telframe_boot_t *b, const uint8_t *data);
+
+#endif
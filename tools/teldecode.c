@@ -0,0 +1,343 @@
+/************************************************************/
+/* Host-Decoder fr die Telemetrie (telemetry.c)			*/
+/*															*/
+/* bersetzen: gcc -I.. -o teldecode teldecode.c ../telframe.c */
+/*															*/
+/* teldecode [datei]  liest den Bytestrom (z.B. Mitschnitt	*/
+/*                    der seriellen Schnittstelle) aus der	*/
+/*                    Datei oder von stdin und gibt die		*/
+/*                    Messwerte als CSV aus.				*/
+/*                    Ein Abzug des Flugschreibers (trace.h)	*/
+/*                    wird als Zeitleiste ausgegeben, Zeiten	*/
+/*                    relativ zum Auslser.					*/
+/* teldecode -t       Loopback-Test: Rahmen werden mit dem	*/
+/*                    Encoder der Firmware erzeugt, ber		*/
+/*                    einen gestrten Kanal geschickt und		*/
+/*                    wieder decodiert.						*/
+/************************************************************/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include "telframe.h"
+
+// Takt von Timer1 in Hz (F_CPU/8), fr die Zeitleiste des Flugschreibers
+#ifndef TIMER_HZ
+#define TIMER_HZ 1500000.0
+#endif
+
+// Zustand des Decoders: bisher empfangene Bytes des aktuellen Rahmens
+typedef struct
+{
+	uint8_t Buf[TELFRAME_MAX];
+	uint8_t n;
+	unsigned long CrcErrors;
+	unsigned long Skipped;
+} dec_t;
+
+// Das erste Byte verwerfen und ab dem nchsten SYNC neu synchronisieren
+static void dec_Resync(dec_t *d)
+{
+	uint8_t i = 1;
+	
+	while ((i<d->n) && (d->Buf[i]!=TELFRAME_SYNC)) i++;
+	d->Skipped+=i;
+	memmove(d->Buf,d->Buf+i,d->n-i);
+	d->n-=i;
+}
+
+// Ein Byte verarbeiten. Rckgabe 1: ein gltiger Rahmen liegt in frame (TELFRAME_MAX Bytes)
+static int dec_Feed(dec_t *d, uint8_t b, uint8_t *frame)
+{
+	uint16_t crc;
+	uint8_t i, len;
+	
+	d->Buf[d->n++]=b;
+	
+	for (;;)
+	{
+		if (d->n==0) return 0;
+		if (d->Buf[0]!=TELFRAME_SYNC)
+		{
+			dec_Resync(d);
+			continue;
+		}
+		if (d->n<3) return 0;
+		
+		len=d->Buf[2];
+		if (len>TELFRAME_MAX_DATA)
+		{
+			dec_Resync(d);
+			continue;
+		}
+		if (d->n<TELFRAME_HEADER+len+TELFRAME_CRC) return 0;
+		
+		crc=0;
+		for (i=1;i<TELFRAME_HEADER+len;i++) crc=telframe_Crc(crc,d->Buf[i]);
+		if ((d->Buf[i]==(crc&0xFF)) && (d->Buf[i+1]==(crc>>8)))
+		{
+			memcpy(frame,d->Buf,TELFRAME_HEADER+len+TELFRAME_CRC);
+			d->n=0;
+			return 1;
+		}
+		
+		// CRC falsch: das SYNC war keines oder der Rahmen ist gestrt
+		d->CrcErrors++;
+		dec_Resync(d);
+	}
+}
+
+// Gesammelte Ereignisse des Flugschreibers, ein Abzug kommt in mehreren Rahmen
+static telframe_event_t trace_Ev[256];
+static uint8_t trace_Have[256];
+
+// Namen der Ereignisse, Nummern wie in trace.h
+static const char *trace_Name(uint8_t id)
+{
+	switch (id)
+	{
+		case 1: return "flanke";
+		case 2: return "block";
+		case 3: return "display start";
+		case 4: return "display ende";
+		case 5: return "pwm";
+		case 6: return "ueberlauf";
+		case 7: return "stillstand";
+		case 8: return "AUSLOESER";
+	}
+	return "?";
+}
+
+// Zeitleiste ausgeben: die Abstnde aufeinanderfolgender Ereignisse ergeben sich aus TCNT1,
+// die Anzahl der Timer1-berlufe dazwischen aus der Differenz der Abtast-Ticks
+static void print_Trace(int total, unsigned ticktop)
+{
+	double t[256], t0 = 0;
+	int i, prev = -1, trig = -1;
+	long dtick, dtime, approx, k;
+	
+	for (i=0;i<total;i++)
+	{
+		if (!trace_Have[i] || (trace_Ev[i].Id==0)) continue;
+		if (prev<0)
+		{
+			t[i]=0;
+		}
+		else
+		{
+			dtick=(uint16_t)(trace_Ev[i].Tick-trace_Ev[prev].Tick);
+			dtime=(uint16_t)(trace_Ev[i].Time-trace_Ev[prev].Time);
+			approx=dtick*(long)ticktop;
+			k=(approx-dtime+32768)/65536;
+			if (k<0) k=0;
+			t[i]=t[prev]+dtime+65536.0*k;
+		}
+		if ((trace_Ev[i].Id==8) && (trig<0)) trig=i;
+		prev=i;
+	}
+	if (prev<0)
+	{
+		printf("# spur: leer\n");
+		return;
+	}
+	if (trig>=0) t0=t[trig];
+	printf("# spur: %d Ereignisse, Zeiten in us relativ zum Ausloeser\n",total);
+	prev=-1;
+	for (i=0;i<total;i++)
+	{
+		if (!trace_Have[i]) printf("#   (Ereignis %d fehlt)\n",i);
+		if (!trace_Have[i] || (trace_Ev[i].Id==0)) continue;
+		printf("# %12.1f %+11.1f  %-14s %u\n",(t[i]-t0)*1e6/TIMER_HZ,
+			(prev<0)?0.0:(t[i]-t[prev])*1e6/TIMER_HZ,trace_Name(trace_Ev[i].Id),trace_Ev[i].Arg);
+		prev=i;
+	}
+}
+
+// Rahmen als CSV bzw. Kommentarzeile ausgeben, Lcken in der Sequenz melden
+static void print_Frame(const uint8_t *f, int *lastseq)
+{
+	telframe_mess_t m;
+	telframe_status_t st;
+	telframe_power_t p;
+	telframe_vibra_t v;
+	telframe_slot_t sl;
+	telframe_trace_t tr;
+	telframe_quad_t q;
+	telframe_isr_t is;
+	telframe_boot_t b;
+	int i;
+	int seq = f[3];
+	
+	if ((*lastseq>=0) && (seq!=((*lastseq+1)&0xFF)))
+	{
+		printf("# %d Rahmen verloren vor seq %d\n",(seq-*lastseq-1)&0xFF,seq);
+	}
+	*lastseq=seq;
+	
+	switch (f[1])
+	{
+		case TELFRAME_TYPE_MESS:
+			if (f[2]<TELFRAME_MESS_LEN) break;
+			telframe_GetMess(&m,f+TELFRAME_HEADER);
+			printf("%d,%u,%u,%u,%u,%d\n",seq,m.Rpm,m.Period,m.Soll,m.Duty,m.Accel);
+		break;
+		
+		case TELFRAME_TYPE_STATUS:
+			if (f[2]<TELFRAME_STATUS_LEN) break;
+			telframe_GetStatus(&st,f+TELFRAME_HEADER);
+			printf("# status seq=%d drops=%u stack=%u\n",seq,st.Drops,st.StackFree);
+		break;
+		
+		case TELFRAME_TYPE_POWER:
+			if (f[2]<TELFRAME_POWER_LEN) break;
+			telframe_GetPower(&p,f+TELFRAME_HEADER);
+			printf("# power seq=%d wakes/s=%u schlaf=%u.%u%%\n",seq,p.Wakes,p.Sleep/10,p.Sleep%10);
+		break;
+		
+		case TELFRAME_TYPE_VIBRA:
+			if (f[2]<TELFRAME_VIBRA_LEN) break;
+			telframe_GetVibra(&v,f+TELFRAME_HEADER);
+			printf("# vibra seq=%d h=%u amp=%u.%02u ticks phase=%u grad periode=%u\n",seq,v.Harm,
+				v.Amp/16,(v.Amp%16)*100/16,v.Phase,v.Mean);
+		break;
+		
+		case TELFRAME_TYPE_SLOT:
+			if (f[2]<TELFRAME_SLOT_LEN) break;
+			telframe_GetSlot(&sl,f+TELFRAME_HEADER);
+			printf("# slot seq=%d s=%u tast=%u.%u%% min=%u.%u%% max=%u.%u%% stoer=%u warn=%s%s%s%s%s%s\n",seq,sl.Slot,
+				sl.Duty/10,sl.Duty%10,sl.Min/10,sl.Min%10,sl.Max/10,sl.Max%10,sl.Glitches,
+				(sl.Flags&0x01)?"L":"",(sl.Flags&0x02)?"H":"",(sl.Flags&0x04)?"S":"",
+				(sl.Flags&0x08)?"G":"",(sl.Flags&0x10)?"M":"",sl.Flags?"":"-");
+		break;
+		
+		case TELFRAME_TYPE_TRACE:
+			if (f[2]<TELFRAME_TRACE_LEN) break;
+			telframe_GetTrace(&tr,f+TELFRAME_HEADER);
+			// Ein neuer Abzug beginnt beim ltesten Ereignis
+			if (tr.First==0) memset(trace_Have,0,sizeof(trace_Have));
+			for (i=0;i<TELFRAME_TRACE_EVENTS;i++)
+			{
+				if (tr.First+i>=tr.Total) break;
+				trace_Ev[tr.First+i]=tr.Ev[i];
+				trace_Have[tr.First+i]=1;
+			}
+			if (tr.First+TELFRAME_TRACE_EVENTS>=tr.Total) print_Trace(tr.Total,tr.TickTop);
+		break;
+		
+		case TELFRAME_TYPE_QUAD:
+			if (f[2]<TELFRAME_QUAD_LEN) break;
+			telframe_GetQuad(&q,f+TELFRAME_HEADER);
+			printf("# quad seq=%d pos=%ld (%.2f U) richtung=%d fehler=%u\n",seq,(long)q.Position,
+				q.StepsPerRev?(double)q.Position/q.StepsPerRev:0.0,q.Dir,q.Errors);
+		break;
+		
+		case TELFRAME_TYPE_ISR:
+			if (f[2]<TELFRAME_ISR_LEN) break;
+			telframe_GetIsr(&is,f+TELFRAME_HEADER);
+			printf("# isr seq=%d kanal=%u aufrufe=%u%s latenz max=%.1fus ausfuehrung max=%.1fus ueber budget(%.1fus)=%u\n",
+				seq,is.Ch,is.Cnt,(is.Cnt==0xFFFF)?"+":"",is.LatMax*1e6/TIMER_HZ,is.ExeMax*1e6/TIMER_HZ,
+				is.Budget*1e6/TIMER_HZ,is.Over);
+		break;
+		
+		case TELFRAME_TYPE_BOOT:
+			if (f[2]<TELFRAME_BOOT_LEN) break;
+			telframe_GetBoot(&b,f+TELFRAME_HEADER);
+			printf("# boot seq=%d anzeige=%u",seq,b.Disp);
+			for (i=0;i<TELFRAME_BOOT_STAGES;i++)
+			{
+				if (b.Time[i]==0xFFFF) continue;
+				printf(" schritt%d=%.1fms",b.First+i,b.Time[i]*(double)b.TickUs/1000.0);
+			}
+			printf("\n");
+		break;
+		
+		default:
+			printf("# typ %u seq=%d len=%u\n",f[1],seq,f[2]);
+		break;
+	}
+}
+
+// Loopback: Encoder der Firmware -> gestrter Kanal -> Decoder
+static int loopback(void)
+{
+	dec_t d;
+	uint8_t Frame[TELFRAME_MAX], Out[TELFRAME_MAX], Data[TELFRAME_MAX_DATA];
+	uint8_t Expect[1000];
+	telframe_mess_t m, r;
+	int i, k, n, got = 0, want = 0, bad = 0;
+	
+	memset(&d,0,sizeof(d));
+	for (i=0;i<1000;i++)
+	{
+		m.Rpm=3000+i;
+		m.Period=(uint16_t)(60000u-i*7);
+		m.Soll=6000;
+		m.Duty=(uint8_t)i;
+		m.Accel=(int16_t)(500-i*3);
+		telframe_PutMess(Data,&m);
+		n=telframe_Pack(Frame,TELFRAME_TYPE_MESS,(uint8_t)i,Data,TELFRAME_MESS_LEN);
+		
+		// Kanalstrungen: Rahmen fehlt, Byte verflscht, Strbytes mit SYNC dazwischen
+		Expect[i]=1;
+		if (i%53==7) { Expect[i]=0; continue; }
+		if (i%37==3) { Frame[5]^=0x10; Expect[i]=0; }
+		if (i%11==0)
+		{
+			uint8_t Junk[] = { 0x00, TELFRAME_SYNC, 0x01, 0x30, TELFRAME_SYNC };
+			for (k=0;k<(int)sizeof(Junk);k++)
+			{
+				if (dec_Feed(&d,Junk[k],Out)) bad++;
+			}
+		}
+		want+=Expect[i];
+		
+		for (k=0;k<n;k++)
+		{
+			if (dec_Feed(&d,Frame[k],Out))
+			{
+				telframe_GetMess(&r,Out+TELFRAME_HEADER);
+				if ((Out[3]!=(uint8_t)i) || !Expect[i] || (r.Rpm!=m.Rpm) || (r.Period!=m.Period) || (r.Duty!=m.Duty) || (r.Accel!=m.Accel))
+				{
+					bad++;
+				}
+				else
+				{
+					got++;
+				}
+			}
+		}
+	}
+	
+	printf("loopback: %d/%d Rahmen korrekt, %d falsch, %lu CRC-Fehler, %lu Bytes uebersprungen\n",
+		got,want,bad,d.CrcErrors,d.Skipped);
+	return ((got==want) && (bad==0))?0:1;
+}
+
+int main(int argc, char **argv)
+{
+	FILE *f = stdin;
+	dec_t d;
+	uint8_t Frame[TELFRAME_MAX];
+	int c, lastseq = -1;
+	
+	if ((argc>1) && (strcmp(argv[1],"-t")==0)) return loopback();
+	
+	if (argc>1)
+	{
+		f=fopen(argv[1],"rb");
+		if (!f)
+		{
+			perror(argv[1]);
+			return 2;
+		}
+	}
+	
+	memset(&d,0,sizeof(d));
+	printf("seq,rpm,period,soll,duty,accel\n");
+	while ((c=fgetc(f))!=EOF)
+	{
+		if (dec_Feed(&d,(uint8_t)c,Frame)) print_Frame(Frame,&lastseq);
+	}
+	fprintf(stderr,"%lu CRC-Fehler, %lu Bytes uebersprungen\n",d.CrcErrors,d.Skipped);
+	return 0;
+}
@@ -0,0 +1,47 @@
+/************************************************************/
+/* Implementierung von trace.h								*/
+/*															*/
+/************************************************************/
+
+#ifdef TRACE
+
+#include "trace.h"
+
+#if (TRACE_N & (TRACE_N-1)) || (TRACE_N < 2) || (TRACE_N > 128)
+#error "TRACE_N muss eine Zweierpotenz zwischen 2 und 128 sein"
+#elif (TRACE_POST >= TRACE_N)
+#error "TRACE_POST muss kleiner als TRACE_N sein"
+#endif
+
+trace_rec_t trace_Buf[TRACE_N];
+uint8_t trace_Ix;
+uint8_t trace_Post;
+uint8_t trace_Stop;
+
+void trace_Init(void)
+{
+	uint8_t i;
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		for (i=0;i<TRACE_N;i++) trace_Buf[i].Id=0;
+		trace_Ix=0;
+		trace_Post=0;
+		trace_Stop=0;
+	}
+}
+
+uint8_t trace_Frozen(void)
+{
+	return trace_Stop;
+}
+
+void trace_Get(uint8_t i, trace_rec_t *r)
+{
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		*r=trace_Buf[(uint8_t)(trace_Ix+i) & (TRACE_N-1)];
+	}
+}
+
+#endif
@@ -0,0 +1,147 @@
+/************************************************************/
+/* Flugschreiber: Ringpuffer mit Ereignissen der Firmware	*/
+/*															*/
+/* Jedes Ereignis (Flanke, Block, Display, PWM, berlauf)	*/
+/* landet mit Zeitstempel in einem festen Ringpuffer im		*/
+/* RAM, die ltesten Eintrge werden berschrieben. Nach	*/
+/* einem Auslser (trace_Trigger) werden noch TRACE_POST	*/
+/* Ereignisse aufgezeichnet, dann friert der Puffer ein und	*/
+/* zeigt, was vor und nach dem Auslser passiert ist.		*/
+/*															*/
+/* Zeitstempel sind systick und TCNT1, damit lassen sich	*/
+/* auch Pausen ber einen berlauf von Timer1 hinweg		*/
+/* (43.7ms) eindeutig rekonstruieren.						*/
+/*															*/
+/* TRACE_PUT und TRACE_TRIGGER sind inline und laufen mit	*/
+/* gesperrten Interrupts, sie knnen aus ISRs und der		*/
+/* Hauptschleife benutzt werden. Ohne TRACE entfallen die	*/
+/* Aufrufe.													*/
+/*															*/
+/* Aktiv nur mit #define TRACE								*/
+/************************************************************/
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+#include <avr/io.h>
+#include <util/atomic.h>
+
+// Anzahl Eintrge im Ring, Zweierpotenz <= 128 (6 Bytes pro Eintrag)
+#ifndef TRACE_N
+#define TRACE_N 16
+#endif
+
+// Ereignisse, die nach dem Auslser noch aufgezeichnet werden (< TRACE_N)
+#ifndef TRACE_POST
+#define TRACE_POST (TRACE_N/4)
+#endif
+
+// Ereignisse (Id), 0 = leerer Eintrag
+#define TRACE_EDGE			1	// Flanke erfasst, Arg: 1 steigend, 0 fallend
+#define TRACE_BLOCK			2	// Block abgeschlossen, Arg: Drehzahl/100 (bis 255)
+#define TRACE_DISP_START	3	// Display-Ausgabe beginnt, Arg: Anzeige (0 Haupt, 1 Detail)
+#define TRACE_DISP_END		4	// Display-Ausgabe fertig, Arg: Anzeige
+#define TRACE_PWM			5	// PWM gendert, Arg: neues OCR0
+#define TRACE_OVERRUN		6	// berlauf, Arg: TRACE_OVR_...
+#define TRACE_STALL			7	// Stillstand gemeldet, Arg: 1 wenn der Motor eingeschaltet ist
+#define TRACE_TRIG			8	// Auslser, Arg: TRACE_WHY_...
+
+// Arg von TRACE_OVERRUN
+#define TRACE_OVR_CAPTURE	1	// Flanke verloren, Puffer der Input-Capture-ISR voll
+#define TRACE_OVR_TICK		2	// Hauptschleife hat einen Tick verpasst
+
+// Arg von TRACE_TRIG
+#define TRACE_WHY_STALL		1	// Stillstand bei eingeschaltetem Motor
+#define TRACE_WHY_OUTLIER	2	// Ausreisser in der Periodenmessung
+#define TRACE_WHY_CAPTURE	3	// Flanke verloren
+
+typedef struct
+{
+	uint8_t Id;			// Ereignis (TRACE_EDGE...)
+	uint8_t Arg;		// Zusatzwert je nach Ereignis
+	uint16_t Tick;		// systick
+	uint16_t Time;		// TCNT1
+} trace_rec_t;
+
+#ifdef TRACE
+
+// Zeitbasis aus main.c
+extern volatile uint16_t systick;
+
+extern trace_rec_t trace_Buf[TRACE_N];
+extern uint8_t trace_Ix;		// nchster Platz im Ring, luft frei durch
+extern uint8_t trace_Post;		// nach dem Auslser noch aufzuzeichnende Ereignisse, 0 = nicht ausgelst
+extern uint8_t trace_Stop;		// 1 = eingefroren
+
+// Eintrag anlegen, nur mit gesperrten Interrupts aufrufen
+static inline void _trace_Rec(uint8_t id, uint8_t arg, uint16_t tick, uint16_t time)
+{
+	trace_rec_t *r;
+
+	if (!trace_Stop)
+	{
+		r=&trace_Buf[trace_Ix & (TRACE_N-1)];
+		trace_Ix++;
+		r->Id=id;
+		r->Arg=arg;
+		r->Tick=tick;
+		r->Time=time;
+		if (trace_Post && (--trace_Post==0)) trace_Stop=1;
+	}
+}
+
+// Ein Ereignis eintragen, inline damit ISRs keine Funktion aufrufen mssen
+static inline void trace_Put(uint8_t id, uint8_t arg)
+{
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		_trace_Rec(id,arg,systick,TCNT1);
+	}
+}
+
+// Ein Ereignis mit einem frher genommenen Zeitstempel eintragen (tick = systick, time = TCNT1),
+// z.B. den Beginn einer Aktion, von der erst am Ende feststeht, ob sie etwas getan hat
+static inline void trace_PutAt(uint8_t id, uint8_t arg, uint16_t tick, uint16_t time)
+{
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		_trace_Rec(id,arg,tick,time);
+	}
+}
+
+// Auslser: Ereignis eintragen, nach TRACE_POST weiteren Ereignissen einfrieren
+// Weitere Auslser vor dem nchsten trace_Init werden ignoriert.
+static inline void trace_Trigger(uint8_t why)
+{
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		if (!trace_Post && !trace_Stop)
+		{
+			// Der Auslser selbst zhlt mit, danach noch TRACE_POST Ereignisse
+			trace_Post=TRACE_POST+1;
+			trace_Put(TRACE_TRIG,why);
+		}
+	}
+}
+
+#define TRACE_PUT(id, arg) trace_Put((id), (arg))
+#define TRACE_TRIGGER(why) trace_Trigger(why)
+
+#else
+
+#define TRACE_PUT(id, arg)
+#define TRACE_TRIGGER(why)
+
+#endif
+
+// Puffer leeren und scharf schalten
+void trace_Init(void);
+
+// 1 wenn der Puffer eingefroren ist und ausgelesen werden kann
+uint8_t trace_Frozen(void);
+
+// Eintrag i (0 = ltester .. TRACE_N-1 = neuester) kopieren, leere Eintrge haben Id 0
+void trace_Get(uint8_t i, trace_rec_t *r);
+
+#endif
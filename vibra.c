@@ -0,0 +1,239 @@
+/************************************************************/
+/* Implementierung von vibra.h								*/
+/*															*/
+/************************************************************/
+
+#ifdef VIBRA
+
+#include "vibra.h"
+
+#if (VIBRA_BLOCK % MESS_PPR) || (VIBRA_BLOCK > 256) || (VIBRA_BLOCK < MESS_PPR)
+#error "VIBRA_BLOCK muss ein Vielfaches von MESS_PPR und <= 256 sein"
+#elif (2*VIBRA_HARM1 > MESS_PPR) || (2*VIBRA_HARM2 > MESS_PPR) || (2*VIBRA_HARM3 > MESS_PPR)
+#error "VIBRA_HARMx > MESS_PPR/2 ist mit einer Abtastung pro Impuls nicht messbar"
+#endif
+
+// Koeffizienten cos/sin(2*pi*h/MESS_PPR) in Q14, zur Compile-Zeit berechnet.
+// Die Reihen sind fr |x| <= pi/2 genauer als 1e-6, grssere Winkel (bis pi) ber pi-x.
+#define _VIBRA_PI 3.14159265358979
+#define _VIBRA_W(h) (2.0*_VIBRA_PI*(h)/MESS_PPR)
+#define _VIBRA_COS0(x) (1.0-(x)*(x)/2*(1.0-(x)*(x)/12*(1.0-(x)*(x)/30*(1.0-(x)*(x)/56*(1.0-(x)*(x)/90)))))
+#define _VIBRA_SIN0(x) ((x)*(1.0-(x)*(x)/6*(1.0-(x)*(x)/20*(1.0-(x)*(x)/42*(1.0-(x)*(x)/72*(1.0-(x)*(x)/110))))))
+#define _VIBRA_COS(x) (((x)>_VIBRA_PI/2)?-_VIBRA_COS0(_VIBRA_PI-(x)):_VIBRA_COS0(x))
+#define _VIBRA_SIN(x) (((x)>_VIBRA_PI/2)?_VIBRA_SIN0(_VIBRA_PI-(x)):_VIBRA_SIN0(x))
+#define _VIBRA_Q14(v) ((int16_t)(((v)>=0)?((v)*16384.0+0.5):((v)*16384.0-0.5)))
+
+static const uint8_t _loc_Harm[VIBRA_FILTERS] = { VIBRA_HARM1, VIBRA_HARM2, VIBRA_HARM3 };
+static const int16_t _loc_Cos[VIBRA_FILTERS] = {
+	_VIBRA_Q14(_VIBRA_COS(_VIBRA_W(VIBRA_HARM1))),
+	_VIBRA_Q14(_VIBRA_COS(_VIBRA_W(VIBRA_HARM2))),
+	_VIBRA_Q14(_VIBRA_COS(_VIBRA_W(VIBRA_HARM3))) };
+static const int16_t _loc_Sin[VIBRA_FILTERS] = {
+	_VIBRA_Q14(_VIBRA_SIN(_VIBRA_W(VIBRA_HARM1))),
+	_VIBRA_Q14(_VIBRA_SIN(_VIBRA_W(VIBRA_HARM2))),
+	_VIBRA_Q14(_VIBRA_SIN(_VIBRA_W(VIBRA_HARM3))) };
+
+// Zustnde der Filter im laufenden Block und Endzustnde des letzten Blocks
+// Mit |x| <= 2047 und hchstens 256 Impulsen bleibt |s| < 2^27
+static int32_t _loc_S1[VIBRA_FILTERS];
+static int32_t _loc_S2[VIBRA_FILTERS];
+static int32_t _loc_R1[VIBRA_FILTERS];
+static int32_t _loc_R2[VIBRA_FILTERS];
+
+static uint8_t _loc_Run = 0;		// 1 sobald eine Bezugsperiode vorliegt
+static uint16_t _loc_N = 0;			// Impulse im laufenden Block
+static uint16_t _loc_Ref;			// Bezugsperiode (Mittelwert des letzten Blocks)
+static uint32_t _loc_Sum = 0;		// Summe der Perioden im laufenden Block
+static uint16_t _loc_Mean = 0;
+static uint16_t _loc_Clipped = 0;
+
+// c (Q14) * s, aufgeteilt in zwei 16x16 Bit Multiplikationen statt einer 32x32 Bit
+// s = (s>>14)*2^14 + (s & 0x3FFF) gilt auch fr negative s, |s| muss < 2^29 sein
+static int32_t _loc_MulQ14(int16_t c, int32_t s)
+{
+	return (int32_t)c*(int16_t)(s>>14)+(((int32_t)c*(uint16_t)(s&0x3FFF))>>14);
+}
+
+// Ganzzahlige Quadratwurzel (bitweise, 16 Schritte)
+static uint16_t _loc_Sqrt(uint32_t x)
+{
+	uint32_t r = 0;
+	uint32_t b = 1UL<<30;
+
+	while (b>x) b>>=2;
+	while (b)
+	{
+		if (x>=r+b)
+		{
+			x-=r+b;
+			r=(r>>1)+b;
+		}
+		else
+		{
+			r>>=1;
+		}
+		b>>=2;
+	}
+	return (uint16_t)r;
+}
+
+// Winkel von (x,y) in 1/100 Grad (0..35999), |x|,|y| < 2^15
+// atan(z) ~ 45z + z(1-z)(14.02+3.80z) Grad fr 0 <= z <= 1, Fehler < 0.1 Grad
+static uint16_t _loc_Atan2(int16_t y, int16_t x)
+{
+	uint16_t ax, ay, z, t, a;
+
+	ax=(x<0)?-x:x;
+	ay=(y<0)?-y:y;
+	if ((ax|ay)==0) return 0;
+
+	// Auf den ersten Oktanten zurckfhren, z = min/max in Q14
+	if (ay<=ax) z=((uint32_t)ay<<14)/ax;
+	else z=((uint32_t)ax<<14)/ay;
+	t=((uint32_t)z*(16384-z))>>14;
+	a=(((uint32_t)4500*z)>>14)+(((uint32_t)t*(1402+(((uint32_t)380*z)>>14)))>>14);
+
+	if (ay>ax) a=9000-a;
+	if (x<0) a=18000-a;
+	if (y<0) a=(a==0)?0:36000-a;
+	return a;
+}
+
+void vibra_Reset(void)
+{
+	uint8_t i;
+
+	for (i=0;i<VIBRA_FILTERS;i++)
+	{
+		_loc_S1[i]=0;
+		_loc_S2[i]=0;
+	}
+	_loc_Run=0;
+	_loc_N=0;
+	_loc_Sum=0;
+}
+
+uint8_t vibra_Sample(uint16_t period)
+{
+	int32_t d, s;
+	int16_t x;
+	uint8_t i;
+
+	if (!_loc_Run)
+	{
+		_loc_Ref=period;
+		_loc_Run=1;
+	}
+
+	// Abweichung vom Bezug, begrenzt damit die Filterzustnde sicher in 32 Bit bleiben
+	d=((int32_t)period-_loc_Ref)>>VIBRA_SHIFT;
+	if (d>2047)
+	{
+		d=2047;
+		_loc_Clipped++;
+	}
+	else if (d<-2047)
+	{
+		d=-2047;
+		_loc_Clipped++;
+	}
+	x=(int16_t)d;
+
+	// Goertzel: s[n] = x[n] + 2cos(w) s[n-1] - s[n-2]
+	for (i=0;i<VIBRA_FILTERS;i++)
+	{
+		if (_loc_Harm[i]==0) continue;
+		s=x+2*_loc_MulQ14(_loc_Cos[i],_loc_S1[i])-_loc_S2[i];
+		_loc_S2[i]=_loc_S1[i];
+		_loc_S1[i]=s;
+	}
+
+	_loc_Sum+=period;
+	if (++_loc_N<VIBRA_BLOCK) return 0;
+
+	// Block abgeschlossen: Endzustnde sichern, ausgewertet wird erst beim Abfragen
+	for (i=0;i<VIBRA_FILTERS;i++)
+	{
+		_loc_R1[i]=_loc_S1[i];
+		_loc_R2[i]=_loc_S2[i];
+		_loc_S1[i]=0;
+		_loc_S2[i]=0;
+	}
+	_loc_Mean=(uint16_t)((_loc_Sum+VIBRA_BLOCK/2)/VIBRA_BLOCK);
+	_loc_Ref=_loc_Mean;
+	_loc_Sum=0;
+	_loc_N=0;
+	return 1;
+}
+
+// DFT-Wert des letzten Blocks, auf 15 Bit verkleinert
+// Bei ganzzahlig vielen Perioden im Block gilt X = e^(jw) s[N-1] - s[N-2]
+// Rckgabe: Anzahl Bits, um die Re und Im verkleinert wurden
+static uint8_t _loc_Result(uint8_t i, int16_t *Re, int16_t *Im)
+{
+	int32_t re, im;
+	uint8_t k = 0;
+
+	re=_loc_MulQ14(_loc_Cos[i],_loc_R1[i])-_loc_R2[i];
+	im=_loc_MulQ14(_loc_Sin[i],_loc_R1[i]);
+	while ((re>32767) || (re<-32767) || (im>32767) || (im<-32767))
+	{
+		re>>=1;
+		im>>=1;
+		k++;
+	}
+	*Re=(int16_t)re;
+	*Im=(int16_t)im;
+	return k;
+}
+
+uint8_t vibra_Harm(uint8_t i)
+{
+	if (i>=VIBRA_FILTERS) return 0;
+	return _loc_Harm[i];
+}
+
+uint16_t vibra_Amp(uint8_t i)
+{
+	int16_t re, im;
+	uint8_t k;
+	uint32_t a;
+
+	if ((i>=VIBRA_FILTERS) || (_loc_Harm[i]==0)) return 0;
+	k=_loc_Result(i,&re,&im);
+
+	// Amplitude = 2|X|/N, in 1/16 Ticks: 32|X|/N
+	// Bei h = MESS_PPR/2 (Nyquist) ist X reell und enthlt die ganze Amplitude: 16|X|/N
+	a=_loc_Sqrt((int32_t)re*re+(int32_t)im*im);
+	a=((a<<((2*_loc_Harm[i]==MESS_PPR)?4:5))+VIBRA_BLOCK/2)/VIBRA_BLOCK;
+	k+=VIBRA_SHIFT;
+	while (k--)
+	{
+		if (a>0x7FFF) return 0xFFFF;
+		a<<=1;
+	}
+	return (a>0xFFFF)?0xFFFF:(uint16_t)a;
+}
+
+uint16_t vibra_Phase(uint8_t i)
+{
+	int16_t re, im;
+	uint16_t a;
+
+	if ((i>=VIBRA_FILTERS) || (_loc_Harm[i]==0)) return 0;
+	_loc_Result(i,&re,&im);
+	a=(_loc_Atan2(im,re)+50)/100;
+	return (a>=360)?0:a;
+}
+
+uint16_t vibra_Mean(void)
+{
+	return _loc_Mean;
+}
+
+uint16_t vibra_Clipped(void)
+{
+	return _loc_Clipped;
+}
+
+#endif
@@ -0,0 +1,69 @@
+/************************************************************/
+/* Schwingungsanalyse aus den Perioden einzelner Impulse	*/
+/*															*/
+/* Unwucht und Lastschwankungen verndern die Periode von	*/
+/* Impuls zu Impuls im Takt der Umdrehung. Die Folge der	*/
+/* Perioden luft durch Goertzel-Filter (Festkomma, Q14)	*/
+/* bei Vielfachen der Drehfrequenz. Pro Block von			*/
+/* VIBRA_BLOCK Impulsen ergibt sich je Filter Amplitude und	*/
+/* Phase der Periodenschwankung.							*/
+/*															*/
+/* Abgetastet wird einmal pro Impuls, deshalb sind nur die	*/
+/* Harmonischen 1..MESS_PPR/2 auswertbar, bei MESS_PPR/2	*/
+/* nur der Anteil in Phase 0 oder 180 Grad. Die Phase bezieht	*/
+/* sich auf den ersten Impuls eines Blocks; ohne Indexmarke	*/
+/* ist sie nur von Block zu Block vergleichbar, solange		*/
+/* keine Flanke verloren geht. Teilungsfehler der Scheibe	*/
+/* erscheinen ebenfalls bei der ersten Harmonischen.		*/
+/*															*/
+/* vibra_Sample kostet pro Filter zwei 16x16 Multiplikationen,	*/
+/* Wurzel und Winkel werden erst beim Abfragen berechnet.	*/
+/*															*/
+/* Aktiv nur mit #define VIBRA (braucht TACHO)				*/
+/************************************************************/
+
+#ifndef VIBRA_H
+#define VIBRA_H
+
+#include <stdint.h>
+#include "messcfg.h"
+
+// Impulse pro Block, Vielfaches von MESS_PPR und <= 256
+// (damit liegen die Harmonischen genau auf den Filterfrequenzen und die Summen bleiben in 32 Bit)
+#ifndef VIBRA_BLOCK
+#define VIBRA_BLOCK (16*MESS_PPR)
+#endif
+
+// Ausgewertete Harmonische der Drehfrequenz (1 = einmal pro Umdrehung), 0 = Filter nicht benutzt
+#ifndef VIBRA_HARM1
+#define VIBRA_HARM1 1
+#endif
+#ifndef VIBRA_HARM2
+#define VIBRA_HARM2 ((MESS_PPR>=4)?2:0)
+#endif
+#ifndef VIBRA_HARM3
+#define VIBRA_HARM3 0
+#endif
+#define VIBRA_FILTERS 3
+
+// Die Abweichung der Periode vom Mittelwert des letzten Blocks wird um VIBRA_SHIFT Bits
+// verkleinert und auf +-2047 begrenzt. Bei grossen Schwankungen (niedrige Drehzahl) erhhen.
+#ifndef VIBRA_SHIFT
+#define VIBRA_SHIFT 0
+#endif
+
+// Zurcksetzen, der nchste Impuls beginnt einen neuen Block (z.B. nach einem Stillstand)
+void vibra_Reset(void);
+
+// Rohe Periode eines Impulses in Timer1-Ticks bergeben
+// Rckgabe: 1 wenn damit ein Block abgeschlossen wurde
+uint8_t vibra_Sample(uint16_t period);
+
+// Ergebnisse des letzten abgeschlossenen Blocks, i = 0..VIBRA_FILTERS-1
+uint8_t vibra_Harm(uint8_t i);		// Harmonische des Filters, 0 = nicht benutzt
+uint16_t vibra_Amp(uint8_t i);		// Amplitude der Periodenschwankung in 1/16 Timer1-Ticks
+uint16_t vibra_Phase(uint8_t i);	// Phase in Grad (0..359), Kosinus bezogen auf den ersten Impuls
+uint16_t vibra_Mean(void);			// mittlere Periode in Timer1-Ticks
+uint16_t vibra_Clipped(void);		// Anzahl begrenzter Abweichungen seit dem Start
+
+#endif
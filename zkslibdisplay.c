@@ -8,6 +8,8 @@
 #include <AVR/io.h>
 #include <util/delay.h>
 #include <stdio.h>
+#include <stdarg.h>
+#include <avr/pgmspace.h>
 #include "zkslibdisplay.h"
 
 #ifdef DISP_MC_NEU
@@ -42,15 +44,90 @@
 #define DISP_DATA 1
 #define DISP_CMD 0
 
+// Wartezeiten der Init-Statemachine in Ticks umrechnen (aufgerundet, +1 weil
+// der aktuelle Tick schon angebrochen ist). Die Rechnung erfolgt zur Compile-Zeit.
+#define DISP_TICKS_US(us) ((uint16_t)((((uint32_t)(us))+DISP_TICK_US-1)/DISP_TICK_US+1))
+#define DISP_INIT_DONE 0xFFFF
+
+// Zugriffe der Bibliotheksfunktionen auf die HW
+// Im Back-Buffer-Betrieb wird nur der Anzeigespeicher gendert und als gendert markiert,
+// zum Display gelangt der Inhalt erst mit display_Commit
+#ifdef DISP_BACKBUFFER
+#define _LOC_HW_POS(x,y)		(_loc_D->Dirty=1)
+#define _LOC_HW_HOME()			(_loc_D->Dirty=1)
+#define _LOC_HW_CHAR(c)			(_loc_D->Dirty=1)
+#define _LOC_HW_TXT(txt,len)	(_loc_D->Dirty=1)
+#else
+#define _LOC_HW_POS(x,y)		_hw_Pos(x,y)
+#define _LOC_HW_HOME()			_hw_Home()
+#define _LOC_HW_CHAR(c)			_hw_CharToDisplay(c)
+#define _LOC_HW_TXT(txt,len)	_hw_TxtToDisplay(txt,len)
+#endif
+
+// HW-Funktionen des Display-Typs
+// Mit DISP_MULTI ber die Funktionstabelle der ausgewhlten Instanz, sonst direkt
+#if defined(DISP_MULTI)
+#define _hw_InitStep(Stage)		(_loc_D->Ops->InitStep(Stage))
+#define _hw_Pos(x,y)			(_loc_D->Ops->Pos(x,y))
+#define _hw_Home()				(_loc_D->Ops->Home())
+#define _hw_CharToDisplay(c)	(_loc_D->Ops->CharToDisplay(c))
+#define _hw_TxtToDisplay(txt,len)	(_loc_D->Ops->TxtToDisplay(txt,len))
+#elif defined(DISP_MEGACARD)
+#define _hw_InitStep			_hw_LcdInitStep
+#define _hw_Pos					_hw_LcdPos
+#define _hw_Home				_hw_LcdHome
+#define _hw_CharToDisplay		_hw_LcdCharToDisplay
+#define _hw_TxtToDisplay		_hw_LcdTxtToDisplay
+#elif defined(DISP_NOKIA)
+#define _hw_InitStep			_hw_NokiaInitStep
+#define _hw_Pos					_hw_NokiaPos
+#define _hw_Home				_hw_NokiaHome
+#define _hw_CharToDisplay		_hw_NokiaCharToDisplay
+#define _hw_TxtToDisplay		_hw_NokiaTxtToDisplay
+#endif
+
+// Grsse der Anzeige, mit DISP_MULTI aus der ausgewhlten Instanz
+#ifdef DISP_MULTI
+#define _LOC_LINES	(_loc_D->Lines)
+#define _LOC_COLS	(_loc_D->Cols)
+#define _LOC_LEN	(_loc_D->Len)
+#else
+#define _LOC_LINES	DISP_LINES
+#define _LOC_COLS	DISP_COLS
+#define _LOC_LEN	DISP_LEN
+#endif
+
+// Balken brauchen das CGRAM des HD44780, groe Ziffern den Font des Nokia
+#ifdef DISP_MULTI
+#define _LOC_IS_LCD		(_loc_D->Ops==&display_OpsLcd)
+#define _LOC_IS_NOKIA	(_loc_D->Ops==&display_OpsNokia)
+#else
+#define _LOC_IS_LCD		1
+#define _LOC_IS_NOKIA	1
+#endif
+
 //#define MAX_CHARS 8
 
 /****************************************************************************************/
-/* Variablen fr Anzeigespeicher und Cursor Positionen															*/
+/* Anzeigespeicher, Cursor Positionen und Tabellen (display_t)						*/
+/* Der HW-Cursor (HwCursorOk) wird von display_FieldSet verstellt, die nchste			*/
+/* Zeichenausgabe setzt ihn neu.														*/
 /****************************************************************************************/
-static uint8_t _loc_DispData[DISP_LEN];
-static uint8_t _loc_Ix = 0;
-static uint8_t _loc_X = 0;
-static uint8_t _loc_Y = 0;
+#ifdef DISP_MULTI
+// Ausgewhlte Instanz (display_Select)
+static display_t *_loc_D;
+#else
+// Die einzige Instanz, _loc_D ist eine Konstante und die Zugriffe gehen auf feste Adressen
+// Bleibt im .bss, die Werte setzt display_InitTask
+static display_t _loc_Disp;
+#define _loc_D (&_loc_Disp)
+#endif
+
+static void _loc_Update(uint8_t Ix, const uint8_t *Text, uint8_t Width);
+static void _loc_FieldText(char *Text, int32_t value, uint8_t Width, uint8_t Fmt);
+#ifdef DISP_MEGACARD
+static void _loc_BarLoad(uint8_t id);
+#endif
 
 int	_loc_put(char c, FILE * f);
 int	_disp_put(char c, FILE * f);
@@ -179,6 +256,66 @@ static const uint8_t fontData7x8[FONT_CHARS][FONT_WIDTH]= {
 /*************************************************************************/
 #endif
 
+#if defined(DISP_NOKIA) && defined(DISP_BIGNUM)
+/*************************************************************************/
+/* Groe Ziffern (siehe display_BigDefine)						         */
+/* Die Ziffern aus fontData7x8 werden zur Compile-Zeit vergrert:       */
+/* jede Spalte DISP_BIG_WIDTH mal wiederholt, jedes Pixel DISP_BIG_HEIGHT*/
+/* mal in die Hhe gezogen und auf die Bnke verteilt.                   */
+/* Eine Ziffer belegt DISP_BIG_WIDTH x DISP_BIG_HEIGHT Zeichenstellen.   */
+/* Pro Stelle stehen 8 Spalten hintereinander im Flash, die Stelle       */
+/* (Ziffer d, Bank k, Teil j) liegt bei ((d*HEIGHT+k)*WIDTH+j)*8.        */
+/* Im Anzeigespeicher steht dafr der Code DISP_BIG_CODE+((d*HEIGHT+k)*WIDTH+j). */
+#define DISP_BIG_CODE (FONT_CHAR_LAST+1)
+#define DISP_BIG_GLYPHS 12		// '0'..'9', ' ', '-'
+#define DISP_BIG_SPACE 10
+#define DISP_BIG_MINUS 11
+
+#if (DISP_BIG_CODE+DISP_BIG_GLYPHS*DISP_BIG_HEIGHT*DISP_BIG_WIDTH) > 256
+#error "DISP_BIG: zu viele Codes fr groe Ziffern"
+#endif
+
+// Bit i der Spalte b wird zu DISP_BIG_HEIGHT gesetzten Bits ab Bit i*DISP_BIG_HEIGHT
+#define _BIG_BIT(b,i) (((((uint32_t)(b))>>(i))&1)*((1UL<<DISP_BIG_HEIGHT)-1)<<(DISP_BIG_HEIGHT*(i)))
+#define _BIG_SPREAD(b) (_BIG_BIT(b,0)|_BIG_BIT(b,1)|_BIG_BIT(b,2)|_BIG_BIT(b,3)| \
+						_BIG_BIT(b,4)|_BIG_BIT(b,5)|_BIG_BIT(b,6)|_BIG_BIT(b,7))
+#define _BIG_COL(b,k) ((uint8_t)(_BIG_SPREAD(b)>>(8*(k))))
+
+#if DISP_BIG_WIDTH==1
+#define _BIG_REP(x) x
+#define _BIG_PAD 0
+#else
+#define _BIG_REP(x) x,x
+#define _BIG_PAD 0,0
+#endif
+
+#define _BIG_BANK(k,c0,c1,c2,c3,c4,c5,c6) { _BIG_REP(_BIG_COL(c0,k)),_BIG_REP(_BIG_COL(c1,k)), \
+	_BIG_REP(_BIG_COL(c2,k)),_BIG_REP(_BIG_COL(c3,k)),_BIG_REP(_BIG_COL(c4,k)), \
+	_BIG_REP(_BIG_COL(c5,k)),_BIG_REP(_BIG_COL(c6,k)),_BIG_PAD }
+
+#if DISP_BIG_HEIGHT==2
+#define _BIG_GLYPH(...) { _BIG_BANK(0,__VA_ARGS__),_BIG_BANK(1,__VA_ARGS__) }
+#else
+#define _BIG_GLYPH(...) { _BIG_BANK(0,__VA_ARGS__),_BIG_BANK(1,__VA_ARGS__),_BIG_BANK(2,__VA_ARGS__) }
+#endif
+
+static const uint8_t _loc_BigFont[DISP_BIG_GLYPHS][DISP_BIG_HEIGHT][8*DISP_BIG_WIDTH] PROGMEM = {
+	_BIG_GLYPH(62, 127, 113,  89,  77, 127,  62), // '0'
+	_BIG_GLYPH(64,  66, 127, 127,  64,  64,   0), // '1'
+	_BIG_GLYPH(98, 115,  89,  73, 111, 102,   0), // '2'
+	_BIG_GLYPH(34,  99,  73,  73, 127,  54,   0), // '3'
+	_BIG_GLYPH(24,  28,  22,  83, 127, 127,  80), // '4'
+	_BIG_GLYPH(39, 103,  69,  69, 125,  57,   0), // '5'
+	_BIG_GLYPH(60, 126,  75,  73, 121,  48,   0), // '6'
+	_BIG_GLYPH( 3,   3, 113, 121,  15,   7,   0), // '7'
+	_BIG_GLYPH(54, 127,  73,  73, 127,  54,   0), // '8'
+	_BIG_GLYPH( 6,  79,  73, 105,  63,  30,   0), // '9'
+	_BIG_GLYPH( 0,   0,   0,   0,   0,   0,   0), // ' '
+	_BIG_GLYPH( 8,   8,   8,   8,   8,   8,   0)  // '-'
+};
+/*************************************************************************/
+#endif
+
 // Lighweight code for conversion from unsigned int to Text
 void _loc_uint2txt(uint32_t  BinData, char * TextBuffer, char NDigit)
 {
@@ -214,9 +351,10 @@ void _loc_uint2txt(uint32_t  BinData, char * TextBuffer, char NDigit)
 // Fr die bertragung eines Bytes muss die Funktion 2x aufgerufen werden 
 // Die zu bertragenen Informationen befinden sich in den 4 unteren Bits
 // Bit 4 zeigt an ob Daten (=1) bertragen werden oder Befehle (=0)
-// Fr die Anzeige eines Zeichens muss die Funktion _hw_CharToDisplay verwendet werden.
-// Die Funktion untersttzt zwei Modi: die Ausgabe ber PORTAB oder die Ausgabe ber ein
-// Port Extender MCP23S08 am SPI Bus (via #define DISP_MC_NEU) 
+// Fr die Anzeige eines Zeichens muss die Funktion _hw_LcdCharToDisplay verwendet werden.
+// Die Funktion untersttzt drei Modi: die Ausgabe ber PORTAB, die Ausgabe ber ein
+// Port Extender MCP23S08 am SPI Bus (via #define DISP_MC_NEU) oder den 8-Bit Bus
+// an DISP_PORT8 (via #define DISP_BUS8, ein EN-Puls pro Byte)
 
 // Change: dataD hlt ein ganzes Byte anstelle eines Halb-Bytes
 // Es werden im Falle eines 4-Bit interfaces immer 2 Aufrufe daraus gemacht.
@@ -262,6 +400,24 @@ void _hw_zToLCD(char dataD, uint8_t IsData)
 		
 		_delay_ms(WAIT_2);
 	
+#elif defined(DISP_BUS8)
+
+	// 8-Bit Bus: das ganze Byte liegt mit einem Schreibzugriff an DB0..DB7
+	PORTA&=~ (1<<DISP_RS | 1<<DISP_EN);
+	DISP_PORT8=dataD;
+	if (IsData)
+	{
+		PORTA|=1<<DISP_RS;
+	}
+	
+	// EN High->Low ausfhren des Befehls
+	PORTA|=1<< DISP_EN;
+	_delay_us(1);
+	
+	// Fallende Flanke an EN -> Ausfhren des Befehls
+	// Die Zykluszeit von EN ist durch die Ausfhrungszeit (>= 37us) des Aufrufers abgedeckt
+	PORTA &= ~(1<< DISP_EN);
+
 #else 	
 	
 	// Ansteuerung des Displays ber die normalen Interface - Leitungen
@@ -331,7 +487,7 @@ void _hw_zToLCD(char dataD, uint8_t IsData)
 
 // Cursor auf 0/0 setzen (DD-RAM)
 // Keine Vernderung der SPeicherdaten
-void _hw_Home(void)
+void _hw_LcdHome(void)
 {
 	//_delay_ms(WAIT_2);
 	//_hw_zToLCD(0x00);      	// LCD-Return-Home 1
@@ -343,133 +499,107 @@ void _hw_Home(void)
 	_delay_ms(2);
 }
 
- // interne Funktion: die Pins und den Display Controller konfigurieren 
- // Die Funktion konfiguriert nur die HW. Keine Zugriffe auf das Memory
-void _hw_Init(void)
+#ifndef DISP_BUS8
+// interne Funktion: ein einzelnes Halbbyte als 8-Bit Befehl ausgeben
+// Wird nur whrend der Initialisierung bentigt, solange der Controller noch im 8-Bit Modus ist.
+// Die Daten stehen in den oberen 4 Bits.
+void _hw_NibbleToLCD(uint8_t dataD)
 {
-
-#ifdef DISP_MC_NEU
-	// Fr das neue Display
-	// Initialisieren des Port Expanders (Alle Bits sind Ausgnge -> Schreibe 0x00 an Reg. 0x00) 
-	spi_TransferWait(MCP23S08_SPI_CHANNEL,MCP23S08_DEVICE_ADRESS_WRITE,MCP23S08_SPI_NCYCLES,SPI_CLKDIV_4,SPI_MODE_0,SPI_MSB_FIRST,0);
-	spi_TransferWait(MCP23S08_SPI_CHANNEL,MCP23S08_REG_ADRESS_DDR,MCP23S08_SPI_NCYCLES,SPI_CLKDIV_4,SPI_MODE_0,SPI_MSB_FIRST,0);
-	spi_TransferWait(MCP23S08_SPI_CHANNEL,0x00,MCP23S08_SPI_NCYCLES,SPI_CLKDIV_4,SPI_MODE_0,SPI_MSB_FIRST,1);
-#else
-	// Fr das alte Display:
-	
-	// Beid er Initialisierung muss ein erster Befehl als 8-Bit Kommando ausgegeben werden.
-	// Danach folgen nur noch 4-Bit Ausgaben, die ber die _hw_zToLCD() abgewicjelt werden.
-
-	// 50ms Warten (Datenblatt)
-	_delay_ms(50);
-
-	
-	// Display Steuerleitungen als Ausgang konfigurieren
-	// Die DB-Leitungen werden im High-Z gehalten und jeweils bei der Datenausgabe gesetzt
-	// Damit bleibt die USB Schnittstelle aktiv
-	DDRA|= 1<<DISP_RS | 1<<DISP_EN ;
-	DDRB|= 1<<DISP_DB7 | 1<<DISP_DB6 | 1<<DISP_DB5 | 1<<DISP_DB4;
-	
-	
-	// Umschalten auf 4-Bit Display
-	// Datenleitungen lschen
-	PORTB&=~(1<<DISP_DB7 | 1<<DISP_DB6 | 1<<DISP_DB5 | 1<<DISP_DB4);
-	// RS=0 und EN =0 
 	PORTA&=~(1<<DISP_RS | 1<<DISP_EN);
-	
-	// Datenleitungen vorbereiten (Datenblatt Controller)
-	PORTB|=(1<<DISP_DB4) | (1<<DISP_DB5);
-	
-	// Den Schreib-Befehl ausfhren
-	PORTB|=(1<<DISP_EN);
+	PORTB&=~(1<<DISP_DB4 | 1<<DISP_DB5 | 1<<DISP_DB6 | 1<<DISP_DB7);
+	if (dataD & 0x10) PORTB|=1<<DISP_DB4;
+	if (dataD & 0x20) PORTB|=1<<DISP_DB5;
+	if (dataD & 0x40) PORTB|=1<<DISP_DB6;
+	if (dataD & 0x80) PORTB|=1<<DISP_DB7;
+
+	PORTA|=1<< DISP_EN;
 	_delay_us(1);
-	PORTB&=~(1<<DISP_EN);
-	
-	// Die Datenleitungen zurck auf Eingang schalten wegen USB 
-	// DDRB&= ~(1<<DISP_DB7 | 1<<DISP_DB6 | 1<<DISP_DB5 | 1<<DISP_DB4);
-	
-	// Wait laut Datenblatt
-	_delay_us(40);
-	  
-	
+	PORTA &= ~(1<< DISP_EN);
+	_delay_us(1);
+}
 #endif
 
-	// ab hier ist die initialisierung ident fr beide Displays.
-
-	// Register des Displays setzen
-	//_delay_ms(WAIT_2);
-	//Alte Version -------------------------------------------------------
-	//_hw_zToLCD(0x03);       // Function Set A
-	//_delay_ms(WAIT_2);
-	//_hw_zToLCD(0x43);       // Function Set B
-	//_delay_ms(WAIT_2);
-	//_hw_zToLCD(0x03);       // Function Set C
-	//_delay_ms(WAIT_2);
-	//_hw_zToLCD(0x02);       // Function Set D
-	//_delay_ms(WAIT_2);
-	//
-	//_hw_zToLCD(0x02);       // Funktion Set High Byte
-	//_delay_ms(WAIT_2);
-	//_hw_zToLCD(0x08);
-	//_delay_ms(WAIT_2);       
-	//
-	//_hw_zToLCD(0x00);       // Display On 1 High Byte
-	//_delay_ms(WAIT_2);
-	//_hw_zToLCD(0x0C);       // Display On 2 Low Byte
-	//_delay_ms(WAIT_2);	
-//
-	//_hw_zToLCD(0x00);       // Display Clear High Byte
-	//_delay_ms(WAIT_2);
-	//_hw_zToLCD(0x01);       // Display Clear Low Byte
-	//_delay_ms(WAIT_2);	
-//
-	//_hw_zToLCD(0x00);       // Entry Mode Set High Byte
-	//_delay_ms(WAIT_2);
-	//_hw_zToLCD(0x06);       // Entry Mode Set Low Byte
-	//_delay_ms(WAIT_2);
-//
-	//_hw_zToLCD(0x00);
-	//_hw_zToLCD(0x0F);
-	//Alte Version Ende -------------------------------------------------------
-
-	// Neue Version (2021):
-	// Function Set: N=1 (2-Zeilen DIsplay) F=0 (5x8 Pixel) DL=0 (4-Bit Display) 
-	_hw_zToLCD(0b00101000,0);
-	_delay_us(40);
-	
-	_hw_zToLCD(0b00101000,0);
-	_delay_us(40);
-	
-	
-	
-	
-	// On/Off
-	// D=1 turn on, D=0 turn off
-	// C=0 no cursor, C=1 cursor
-	// B=1 blink on, B=0 blink off
-	// 0b00001DCB
-	_hw_zToLCD(0b00001100,0);
-	_delay_us(40);
-	 		
-	// Cursor or Display shift
-	// S/C R/L is set to 0
-			 
-	// Clear Display
-	_hw_zToLCD(0b00000001,0);
-	_delay_ms(2);
-			 
-	// ENtry Mode
-	// I/D=1 cursor right & increase DDRAM, I/D=0 go left and decrease DDRAM
-	// S=1 Perform shift S=0 no shift
-	_hw_zToLCD(0b00000110,0);
-	_delay_ms(2);
-
-	_hw_Home();
-	
+// interne Funktion: einen Schritt der Initialisierung ausfhren
+// Die Funktion konfiguriert nur die HW. Keine Zugriffe auf das Memory
+// Stage: Nummer des Schritts, beginnend bei 0
+// Rckgabe: Wartezeit in Ticks bis zum nchsten Schritt, DISP_INIT_DONE nach dem letzten Schritt
+// Kurze Wartezeiten (< 1 Tick) werden direkt mit _delay_us abgewartet.
+uint16_t _hw_LcdInitStep(uint8_t Stage)
+{
+	switch (Stage)
+	{
+		case 0:
+#ifdef DISP_MC_NEU
+			// Fr das neue Display
+			// Initialisieren des Port Expanders (Alle Bits sind Ausgnge -> Schreibe 0x00 an Reg. 0x00) 
+			spi_TransferWait(MCP23S08_SPI_CHANNEL,MCP23S08_DEVICE_ADRESS_WRITE,MCP23S08_SPI_NCYCLES,SPI_CLKDIV_4,SPI_MODE_0,SPI_MSB_FIRST,0);
+			spi_TransferWait(MCP23S08_SPI_CHANNEL,MCP23S08_REG_ADRESS_DDR,MCP23S08_SPI_NCYCLES,SPI_CLKDIV_4,SPI_MODE_0,SPI_MSB_FIRST,0);
+			spi_TransferWait(MCP23S08_SPI_CHANNEL,0x00,MCP23S08_SPI_NCYCLES,SPI_CLKDIV_4,SPI_MODE_0,SPI_MSB_FIRST,1);
+#else
+			// Display Steuerleitungen als Ausgang konfigurieren
+			DDRA|= 1<<DISP_RS | 1<<DISP_EN ;
+#ifdef DISP_BUS8
+			DISP_DDR8=0xFF;
+#else
+			DDRB|= 1<<DISP_DB7 | 1<<DISP_DB6 | 1<<DISP_DB5 | 1<<DISP_DB4;
+#endif
+			PORTA&=~(1<<DISP_RS | 1<<DISP_EN);
+#endif
+			// 50ms Warten nach dem Einschalten (Datenblatt)
+			return DISP_TICKS_US(50000);
+		
+		case 1:
+		case 2:
+		case 3:
+			// Drei mal Function Set 8-Bit, damit ist der Controller in einem
+			// definierten Zustand, egal ob er vorher im 4- oder 8-Bit Modus war
+#if defined(DISP_BUS8)
+			_hw_zToLCD(0x30,0);
+#elif !defined(DISP_MC_NEU)
+			_hw_NibbleToLCD(0x30);
+#endif
+			return (Stage==1)?DISP_TICKS_US(4100):DISP_TICKS_US(100);
+		
+		case 4:
+#ifdef DISP_BUS8
+			// Function Set: DL=1 (8-Bit Display) N=1 (2-Zeilen Display) F=0 (5x8 Pixel)
+			_hw_zToLCD(0b00111000,0);
+			_delay_us(40);
+#else
+			// Umschalten auf 4-Bit Display
+#ifndef DISP_MC_NEU
+			_hw_NibbleToLCD(0x20);
+			_delay_us(40);
+#endif
+			// Function Set: N=1 (2-Zeilen DIsplay) F=0 (5x8 Pixel) DL=0 (4-Bit Display) 
+			_hw_zToLCD(0b00101000,0);
+			_delay_us(40);
+#endif
+			
+			// On/Off
+			// D=1 turn on, D=0 turn off
+			// C=0 no cursor, C=1 cursor
+			// B=1 blink on, B=0 blink off
+			// 0b00001DCB
+			_hw_zToLCD(0b00001100,0);
+			_delay_us(40);
+			
+			// Clear Display
+			_hw_zToLCD(0b00000001,0);
+			return DISP_TICKS_US(2000);
+			
+		default:
+			// ENtry Mode
+			// I/D=1 cursor right & increase DDRAM, I/D=0 go left and decrease DDRAM
+			// S=1 Perform shift S=0 no shift
+			_hw_zToLCD(0b00000110,0);
+			_delay_us(40);
+			return DISP_INIT_DONE;
+	}
 }
 
 // Setzt den Cursor an eine entsprechende X/Y Position         
-void _hw_Pos(uint8_t x, uint8_t y)
+void _hw_LcdPos(uint8_t x, uint8_t y)
 {
 	//unsigned char Zeichen;
 
@@ -495,7 +625,7 @@ void _hw_Pos(uint8_t x, uint8_t y)
 }
 
 // Low-Level Ausgabe eines Zeichens auf dem Display-Bus 
-void _hw_CharToDisplay(uint8_t c)
+void _hw_LcdCharToDisplay(uint8_t c)
 {
 	unsigned char Zeichen;
 
@@ -504,6 +634,35 @@ void _hw_CharToDisplay(uint8_t c)
 	_delay_us(50);          
 }
 
+// Low-Level Ausgabe mehrerer Zeichen ab der aktuellen HW-Position
+// Der Controller erhht die DD-RAM Adresse selbst (Entry Mode I/D=1),
+// deshalb werden die Zeichen ohne Cursor-Befehle direkt hintereinander bertragen.
+void _hw_LcdTxtToDisplay(const uint8_t *txt, uint8_t len)
+{
+	while (len)
+	{
+		_hw_zToLCD(*txt++,1);
+		_delay_us(50);
+		len--;
+	}
+}
+
+// Ein CGRAM-Zeichen (slot 0..7) laden, alle 8 Pixelzeilen erhalten das Muster row
+// Danach zeigt der Adresszhler des Controllers ins CGRAM, vor der nchsten
+// Zeichenausgabe muss mit _hw_LcdPos wieder eine DD-RAM Adresse gesetzt werden.
+void _hw_CgWrite(uint8_t slot, uint8_t row)
+{
+	uint8_t Cnt;
+	
+	_hw_zToLCD(0x40|((slot&0x07)<<3),0);
+	_delay_us(40);
+	for (Cnt=0;Cnt<8;Cnt++)
+	{
+		_hw_zToLCD(row,1);
+		_delay_us(50);
+	}
+}
+
 #endif
 
 #ifdef DISP_NOKIA
@@ -520,8 +679,8 @@ void _hw_CharToDisplay(uint8_t c)
 #define NOKIA_SET_RST (NOKIA_CONTROL_PORT|=(1<<NOKIA_RST_BIT))
 #define NOKIA_CLEAR_RST (NOKIA_CONTROL_PORT&=~(1<<NOKIA_RST_BIT))
 
-#define NOKIA_ROWS DISP_LINES
-#define NOKIA_COLS DISP_COLS
+#define NOKIA_ROWS DISP_NOKIA_LINES
+#define NOKIA_COLS DISP_NOKIA_COLS
 #define NOKIA_PIXEL_X 84
 #define NOKIA_PIXEL_Y 48
 #define NOKIA_FIRST_USER_LINE 1
@@ -592,49 +751,72 @@ void _hw_NokiaClearDisplay(void)
 };
 
 /*********************************************************************/
-void _hw_Init(void)
+/* Performs one step of the display initialization                   */
+/* Returns the wait time in ticks before the next step,              */
+/* DISP_INIT_DONE after the last step.                               */
+/* The 504 byte clear is split into one bank per step.               */
+uint16_t _hw_NokiaInitStep(uint8_t Stage)
 {
-	// The SPI Interface is assumed to be initialized
-	
-	// init control port
-	NOKIA_DDR_PORT|=(1<<NOKIA_RST_BIT)|(1<<NOKIA_CD_BIT);
-	//NOKIA_CONTROL_PORT|=(1<<NOKIA_RST_BIT)|(1<<NOKIA_SET_CD)|(1<<NOKIA_SET_CS);
-	
-	
-	// Default level is high for all control lines
-	NOKIA_SET_RST;
-	NOKIA_SET_CD;
-	//NOKIA_SET_CS;
-	_delay_ms(10);
-
-	// Reset the device
-	NOKIA_CLEAR_RST;
-	_delay_ms(100);
-	NOKIA_SET_RST;
-	_delay_ms(100);
+	uint8_t Cnt;
 	
-	// Aktivate the Display in Extended command mode
+	switch (Stage)
+	{
+		case 0:
+			// The SPI Interface is assumed to be initialized
 	
-	_hw_NokiaCmdWrite(0x21);
+			// init control port
+			NOKIA_DDR_PORT|=(1<<NOKIA_RST_BIT)|(1<<NOKIA_CD_BIT);
 	
+			// Default level is high for all control lines
+			NOKIA_SET_RST;
+			NOKIA_SET_CD;
+			return DISP_TICKS_US(10000);
+			
+		case 1:
+			// Reset the device
+			NOKIA_CLEAR_RST;
+			return DISP_TICKS_US(100000);
+			
+		case 2:
+			NOKIA_SET_RST;
+			return DISP_TICKS_US(100000);
+			
+		case 3:
+			// Aktivate the Display in Extended command mode
+			_hw_NokiaCmdWrite(0x21);
 	
-	// Adjust the contrast
-	_hw_NokiaCmdWrite(0x8f);
+			// Adjust the contrast
+			_hw_NokiaCmdWrite(0x8f);
 	
-	// Switch back to normal command mode
-	_hw_NokiaCmdWrite(0x20);
-	
-	// Set normal display mode
-	_hw_NokiaCmdWrite(0x0c);
-		
-	// Clear the Display
-	_hw_NokiaClearDisplay();
+			// Switch back to normal command mode
+			_hw_NokiaCmdWrite(0x20);
 	
+			// Set normal display mode
+			_hw_NokiaCmdWrite(0x0c);
+			
+			// Set the Data Pointer to 0/0 for the clear
+			_hw_NokiaCmdWrite(NOKIA_X_BASE);
+			_hw_NokiaCmdWrite(NOKIA_Y_BASE);
+			return 0;
+			
+		default:
+			// Clear one bank (84 Bytes) per step
+			for (Cnt=0;Cnt<NOKIA_PIXEL_X;Cnt++)
+			{
+				_hw_NokiaDataWrite(0x00);
+			}
+			if (Stage<(3+NOKIA_PIXEL_Y/8)) return 0;
+			
+			// Set the Data Pointer to 0/0
+			_hw_NokiaCmdWrite(NOKIA_X_BASE);
+			_hw_NokiaCmdWrite(NOKIA_Y_BASE);
+			return DISP_INIT_DONE;
+	}
 }
 
 /*************************************************************/
 /* Sets the next Output to position(col, row)	       		 */
-void _hw_Pos(unsigned char col, unsigned char row)
+void _hw_NokiaPos(unsigned char col, unsigned char row)
 {
 	// catch invalid parameters
 	if(row>=NOKIA_ROWS) row=(NOKIA_ROWS-1);
@@ -648,9 +830,9 @@ void _hw_Pos(unsigned char col, unsigned char row)
 
 /*************************************************************/
 /* Sets the next Output to position(0,0) of user space					 */
-void _hw_Home(void)
+void _hw_NokiaHome(void)
 {
-	_hw_Pos(0,0);
+	_hw_NokiaPos(0,0);
 }
 
 
@@ -659,7 +841,7 @@ void _hw_Home(void)
 // Headline and Footline
 
 // Clear the user space
-void _hw_Clear()
+void _hw_NokiaClear()
 {
 	_hw_NokiaClearDisplay();
 }
@@ -667,10 +849,23 @@ void _hw_Clear()
 
 /*************************************************************/
 /* Display character at current position in user space                    */
-void _hw_CharToDisplay (uint8_t c)
+void _hw_NokiaCharToDisplay (uint8_t c)
 {
 	uint8_t cnt;
 	
+#ifdef DISP_BIGNUM
+	if (c>=DISP_BIG_CODE)
+	{
+		// Teil einer groen Ziffer: 8 Spalten aus dem Flash
+		const uint8_t *p=&_loc_BigFont[0][0][0]+(uint16_t)(c-DISP_BIG_CODE)*8;
+		for (cnt=0;cnt<8;cnt++)
+		{
+			_hw_NokiaDataWrite(pgm_read_byte(p++));
+		}
+		return;
+	}
+#endif
+	
 	// fix data out of range
 	if (c<FONT_CHAR_FIRST) c=FONT_CHAR_FIRST;
 	if (c>FONT_CHAR_LAST) c=FONT_CHAR_LAST;
@@ -688,6 +883,60 @@ void _hw_CharToDisplay (uint8_t c)
 	_hw_NokiaDataWrite (0);
 	
 }
+
+/*************************************************************/
+/* Display len characters starting at the current position   */
+/* The controller increments the address itself, so the      */
+/* glyph columns are streamed without further commands.      */
+void _hw_NokiaTxtToDisplay(const uint8_t *txt, uint8_t len)
+{
+	uint8_t c, cnt;
+	
+	// Data mode for the whole burst
+	NOKIA_SET_CD;
+	
+	while (len)
+	{
+		c=*txt++;
+#ifdef DISP_BIGNUM
+		if (c>=DISP_BIG_CODE)
+		{
+			// Teil einer groen Ziffer: 8 Spalten aus dem Flash
+			const uint8_t *p=&_loc_BigFont[0][0][0]+(uint16_t)(c-DISP_BIG_CODE)*8;
+			for (cnt=0;cnt<8;cnt++)
+			{
+				spi_TransferWait(NOKIA_SPI_CHANNEL,pgm_read_byte(p++),8,SPI_CLKDIV_4,SPI_MODE_0,SPI_MSB_FIRST,1);
+			}
+			len--;
+			continue;
+		}
+#endif
+		if (c<FONT_CHAR_FIRST) c=FONT_CHAR_FIRST;
+		if (c>FONT_CHAR_LAST) c=FONT_CHAR_LAST;
+		c=c-FONT_CHAR_FIRST;
+		
+		for (cnt=0;cnt<FONT_WIDTH;cnt++)
+		{
+			spi_TransferWait(NOKIA_SPI_CHANNEL,fontData7x8[c][cnt],8,SPI_CLKDIV_4,SPI_MODE_0,SPI_MSB_FIRST,1);
+		}
+		spi_TransferWait(NOKIA_SPI_CHANNEL,0,8,SPI_CLKDIV_4,SPI_MODE_0,SPI_MSB_FIRST,1);
+		len--;
+	}
+}
+#endif
+
+#ifdef DISP_MULTI
+// Funktionstabellen fr display_Create
+#ifdef DISP_MEGACARD
+const display_ops_t display_OpsLcd = {
+	_hw_LcdInitStep, _hw_LcdPos, _hw_LcdHome, _hw_LcdCharToDisplay, _hw_LcdTxtToDisplay,
+	DISP_LCD_LINES, DISP_LCD_COLS };
+#endif
+#ifdef DISP_NOKIA
+const display_ops_t display_OpsNokia = {
+	_hw_NokiaInitStep, _hw_NokiaPos, _hw_NokiaHome, _hw_NokiaCharToDisplay, _hw_NokiaTxtToDisplay,
+	DISP_NOKIA_LINES, DISP_NOKIA_COLS };
+#endif
 #endif
 
 
@@ -701,7 +950,8 @@ void _hw_CharToDisplay (uint8_t c)
 
 
 // Folgende Funktionen mssen HW-seitig zur Verfgung stehen:
-// _hw_Home, _hw_Init, _hw_CharToDisplay, _hw_Pos 
+// _hw_Home, _hw_InitStep, _hw_CharToDisplay, _hw_TxtToDisplay, _hw_Pos 
+// (pro Typ mit eigenem Prfix, zugeordnet ber die Makros am Anfang bzw. display_ops_t)
 
 // Wrapper fr die callbackfunktion zur AUsgabe eines Zeichens auf dem Display
 // Damit werden Compiler-Warnungen vermieden.
@@ -720,13 +970,13 @@ void _loc_ClearLine(uint8_t IxLine)
 	uint8_t Ix = 0;
 
 	// Prfe ob Linienindex zulssig
-	if(IxLine<DISP_LINES)
+	if(IxLine<_LOC_LINES)
 	{
 		// berschreiben des Speichers
-		Ix=IxLine*DISP_COLS;
-		for(Cnt=0;Cnt<DISP_COLS;Cnt++)
+		Ix=IxLine*_LOC_COLS;
+		for(Cnt=0;Cnt<_LOC_COLS;Cnt++)
 		{
-			_loc_DispData[Ix]=' ';
+			_loc_D->Data[Ix]=' ';
 			Ix++;
 		}
 	}
@@ -740,26 +990,23 @@ void _loc_Refresh(void)
 {
 	//lokale Variablen 
 	uint8_t CntLines;
-	uint8_t CntCols;
 	uint8_t Ix=0;
 		
 	// Ix Zeigt auf das erste zu bertragende Zeichen 
 	
-	for (CntLines=0;CntLines<DISP_LINES;CntLines++)
+	for (CntLines=0;CntLines<_LOC_LINES;CntLines++)
 	{
 		// Den Cursor auf den Beginn der nchsten zeile setzen
-		_hw_Pos(0,CntLines);
+		_LOC_HW_POS(0,CntLines);
 		
-		for(CntCols=0;CntCols<DISP_COLS;CntCols++)
-		{
-			// Zeichen ausgeben und Zhler erhhen
-			_hw_CharToDisplay(_loc_DispData[Ix]);
-			Ix++;
-		}
+		// Die ganze Zeile am Stck ausgeben
+		_LOC_HW_TXT(&_loc_D->Data[Ix],_LOC_COLS);
+		Ix+=_LOC_COLS;
 	}
 	
 	// Cursor wieder an die aktuelle stelle setzen
-	_hw_Pos(_loc_X,_loc_Y);
+	_LOC_HW_POS(_loc_D->X,_loc_D->Y);
+	_loc_D->HwCursorOk=1;
 }
 
 
@@ -770,13 +1017,13 @@ void _loc_ScrollUp(void)
 	uint8_t kx;
 	
 	// Kopieren der Zeilen unteren N Zeilen um eine Zeile nach oben im Datenspeicher
-	for(kx=0;kx<((DISP_LINES-1)*DISP_COLS);kx++)
+	for(kx=0;kx<((_LOC_LINES-1)*_LOC_COLS);kx++)
 	{
-		_loc_DispData[kx]=_loc_DispData[kx+DISP_COLS];
+		_loc_D->Data[kx]=_loc_D->Data[kx+_LOC_COLS];
 	}
 	
 	// Lschen der untersten Zeile
-	_loc_ClearLine(DISP_LINES-1);
+	_loc_ClearLine(_LOC_LINES-1);
 	
 	// Display Inhalt aktualisieren
 	_loc_Refresh();
@@ -787,12 +1034,12 @@ void _loc_PrintDispData(void)
 	uint8_t Cnt1,Cnt2,ix;
 	
 	ix=0;
-	for(Cnt1=0;Cnt1<DISP_LINES;Cnt1++)
+	for(Cnt1=0;Cnt1<_LOC_LINES;Cnt1++)
 	{
 		printf("\nd(%d)=",Cnt1);
-		for(Cnt2=0;Cnt2<DISP_COLS;Cnt2++)
+		for(Cnt2=0;Cnt2<_LOC_COLS;Cnt2++)
 		{
-			printf(" %d ",_loc_DispData[ix]);
+			printf(" %d ",_loc_D->Data[ix]);
 			ix++;
 		}
 	}
@@ -807,26 +1054,122 @@ void _loc_PrintDispData(void)
 /* Hier folgen die Bibliotheksfunktionen                                  */
 /* Diese greifen ausschliesslich auf Low Level Funktionen zu              */
 
+#ifdef DISP_MULTI
+// Eine Instanz anlegen, alle Tabellen sind danach leer
+void display_Create(display_t *d, const display_ops_t *ops, uint8_t *buf)
+{
+	uint8_t *p = (uint8_t *)d;
+	uint16_t Cnt;
+	
+	for (Cnt=0;Cnt<sizeof(display_t);Cnt++)
+	{
+		*p++=0;
+	}
+	d->Ops=ops;
+	d->Lines=ops->Lines;
+	d->Cols=ops->Cols;
+	d->Len=ops->Lines*ops->Cols;
+	d->Data=buf;
+#ifdef DISP_BACKBUFFER
+	d->Shown=buf+d->Len;
+#endif
+	d->HwCursorOk=1;
+}
+
+// Die Instanz fr die folgenden Aufrufe auswhlen
+void display_Select(display_t *d)
+{
+	_loc_D=d;
+}
+#endif
+
 // Init the display controller
+// Blockierende Variante: die Schritte der Init-Statemachine werden
+// direkt hintereinander ausgefhrt, gewartet wird mit _delay_us
 void display_Init(void)
+{
+	uint16_t Now = 0;
+
+	display_InitStart(Now);
+	while (!display_InitTask(Now))
+	{
+		_delay_us(DISP_TICK_US);
+		Now++;
+	}
+}
+
+// Nicht-blockierende Initialisierung starten
+// Es erfolgt noch kein Zugriff auf die HW, der erste Schritt wird beim
+// nchsten Aufruf von display_InitTask ausgefhrt
+void display_InitStart(uint16_t now)
 {
 	uint8_t Cnt;
+	
+	for (Cnt=0;Cnt<DISP_INIT_STAGES;Cnt++)
+	{
+		_loc_D->InitTime[Cnt]=0xFFFF;
+	}
+	_loc_D->InitStage=0;
+	_loc_D->InitStart=now;
+	_loc_D->InitDue=now;
+	_loc_D->Ready=0;
+}
 
-	// Intitialisieren des Controllers	
-	_hw_Init();
+// Einen flligen Schritt der Initialisierung ausfhren
+// now: aktueller Stand des Tick-Zhlers (DISP_TICK_US pro Tick)
+// Rckgabe: 1 wenn das Display bereit ist
+uint8_t display_InitTask(uint16_t now)
+{
+	uint8_t Cnt;
+	uint16_t Wait;
+	
+	if (_loc_D->Ready) return 1;
+	
+	// Noch nicht fllig? (Vergleich berlaufsicher)
+	if ((int16_t)(now-_loc_D->InitDue)<0) return 0;
+	
+	Wait=_hw_InitStep(_loc_D->InitStage);
+	if (_loc_D->InitStage<DISP_INIT_STAGES)
+	{
+		_loc_D->InitTime[_loc_D->InitStage]=now-_loc_D->InitStart;
+	}
+	_loc_D->InitStage++;
+	
+	if (Wait!=DISP_INIT_DONE)
+	{
+		_loc_D->InitDue=now+Wait;
+		return 0;
+	}
 	
 	// Initialisieren der internen Variablen und des internen Memories
-	for(Cnt=0;Cnt<DISP_LINES;Cnt++)
+	for(Cnt=0;Cnt<_LOC_LINES;Cnt++)
 	{
 		_loc_ClearLine(Cnt);
 	}
+#ifdef DISP_BACKBUFFER
+	// Die Init-Sequenz hat das Display gelscht
+	for(Cnt=0;Cnt<_LOC_LEN;Cnt++)
+	{
+		_loc_D->Shown[Cnt]=' ';
+	}
+	_loc_D->Dirty=0;
+#endif
+#ifdef DISP_MEGACARD
+	// Das CGRAM hat nach dem Einschalten einen zuflligen Inhalt
+	for(Cnt=0;Cnt<DISP_BARS;Cnt++)
+	{
+		_loc_D->Bars[Cnt].Loaded=0xFF;
+	}
+#endif
 	
-	_loc_X=0;
-	_loc_Y=0;
-	_loc_Ix=0;
-	
+	_loc_D->X=0;
+	_loc_D->Y=0;
+	_loc_D->Ix=0;
+	_loc_D->HwCursorOk=1;
+	_loc_D->Ready=1;
 	
 	// Konfigurieren des stdout Kanals
+	// printf zieht vfprintf aus der avr-libc mit, display_Printf ist die schlanke Alternative
 #ifdef STDOUT_DISP	
 	display_Clear();
 	stdout = &disp_str;	
@@ -834,6 +1177,15 @@ void display_Init(void)
 	
 	//_loc_PrintDispData();
 	
+	return 1;
+}
+
+// Zeitpunkt (Ticks seit display_InitStart) an dem ein Init-Schritt ausgefhrt wurde
+// 0xFFFF: Schritt wurde (noch) nicht ausgefhrt
+uint16_t display_InitStageTime(uint8_t stage)
+{
+	if (stage>=DISP_INIT_STAGES) return 0xFFFF;
+	return _loc_D->InitTime[stage];
 }
 
 // Lscht das gesamt Display und setzt den Cursor oben links (Home)
@@ -845,7 +1197,7 @@ void display_Clear(void)
 	uint8_t Cnt;
 	
 	// Alle Zeilen mit Spaces fllen
-	for(Cnt=0;Cnt<DISP_LINES;Cnt++)
+	for(Cnt=0;Cnt<_LOC_LINES;Cnt++)
 	{
 		_loc_ClearLine(Cnt);
 	}
@@ -863,12 +1215,12 @@ void display_Clear(void)
 void display_Home(void)
 {
 	// Aufruf der Low-Level Funktion
-	_hw_Home();
+	_LOC_HW_HOME();
 	
 	// Die Datenpointer richtig setzen
-	_loc_X=0;
-	_loc_Y=0;
-	_loc_Ix=0;
+	_loc_D->X=0;
+	_loc_D->Y=0;
+	_loc_D->Ix=0;
 }
 
 // Den Cursor an eine beliebige Position im Display verschieben
@@ -877,15 +1229,15 @@ void display_Home(void)
 // Zhler beginnt bei 0
 void display_Pos(unsigned char x, unsigned char y)
 {
-	if((x<DISP_COLS)&&(y<DISP_LINES))
+	if((x<_LOC_COLS)&&(y<_LOC_LINES))
 	{
 		// Aufruf der Low-Level Funktion
-		_hw_Pos(x,y);
+		_LOC_HW_POS(x,y);
 		
 		// Update der Datenpointer
-		_loc_Y=y;
-		_loc_X=x;
-		_loc_Ix=y*DISP_COLS+x;
+		_loc_D->Y=y;
+		_loc_D->X=x;
+		_loc_D->Ix=y*_LOC_COLS+x;
 		
 	}
 	
@@ -905,29 +1257,29 @@ void display_CharToDisplay (uint8_t c)
 		case ASCII_CR:
 			// Den Cursor auf den aktuellen Zeilenanfang verschieben ohne
 			// Zeilenvorschub
-			_loc_Ix-=_loc_X;
-			_loc_X=0;
-			_hw_Pos(_loc_X,_loc_Y);
+			_loc_D->Ix-=_loc_D->X;
+			_loc_D->X=0;
+			_LOC_HW_POS(_loc_D->X,_loc_D->Y);
 		break;
 		
 		case ASCII_LF:
 			// Den Cursor an den Beginn der nchsten Zeile verschieben
-			_loc_Y++;
+			_loc_D->Y++;
 			
 			// Display-Ende erreicht ?
-			if (_loc_Y>=DISP_LINES)
+			if (_loc_D->Y>=_LOC_LINES)
 			{
 				_loc_ScrollUp();
-				_loc_X=0;
-				_loc_Y=DISP_LINES-1;
-				_loc_Ix=DISP_LEN-DISP_COLS;
+				_loc_D->X=0;
+				_loc_D->Y=_LOC_LINES-1;
+				_loc_D->Ix=_LOC_LEN-_LOC_COLS;
 			}
 			else
 			{
-				_loc_Ix=(_loc_Ix+DISP_COLS)-_loc_X;
-				_loc_X=0;
+				_loc_D->Ix=(_loc_D->Ix+_LOC_COLS)-_loc_D->X;
+				_loc_D->X=0;
 			}
-			_hw_Pos(_loc_X,_loc_Y);
+			_LOC_HW_POS(_loc_D->X,_loc_D->Y);
 		break;
 		default:
 			// Ausgabe im Display und Eintrag im Datenspeicher
@@ -941,28 +1293,35 @@ void display_CharToDisplay (uint8_t c)
 			// dass beim letzten Zeichen bereits die Zeile nach oben verschwindet.
 			
 			// Zeilenende erreicht ?
-			if (_loc_X>=DISP_COLS)
+			if (_loc_D->X>=_LOC_COLS)
 			{
-				_loc_Y++;
-				_loc_X=0;
+				_loc_D->Y++;
+				_loc_D->X=0;
 				
 				// Display-Ende erreicht ?
-				if (_loc_Y>=DISP_LINES)
+				if (_loc_D->Y>=_LOC_LINES)
 				{
 					_loc_ScrollUp();
-					_loc_Y=DISP_LINES-1;
-					_loc_Ix=DISP_LEN-DISP_COLS;
+					_loc_D->Y=_LOC_LINES-1;
+					_loc_D->Ix=_LOC_LEN-_LOC_COLS;
 				}
-				_hw_Pos(_loc_X,_loc_Y);
+				_LOC_HW_POS(_loc_D->X,_loc_D->Y);
+			}
+			
+			// Nach einem display_FieldSet steht der HW-Cursor im Feld
+			if (!_loc_D->HwCursorOk)
+			{
+				_LOC_HW_POS(_loc_D->X,_loc_D->Y);
+				_loc_D->HwCursorOk=1;
 			}
 			
 			// Jetzt erfolgt die Ausgabe des Zeichens und die Speicherung im internen Mem
-			_hw_CharToDisplay(c);
-			_loc_DispData[_loc_Ix]=c;			
+			_LOC_HW_CHAR(c);
+			_loc_D->Data[_loc_D->Ix]=c;			
 	
 			// Inkremetieren der Pointer, danach werden die Werte geprft
-			_loc_X++;
-			_loc_Ix++;
+			_loc_D->X++;
+			_loc_D->Ix++;
 
 			
 		break;
@@ -978,9 +1337,9 @@ void display_Test(void)
 	uint8_t Cnt;
 	
 	// Fill Data Memory with Test Data
-	//for(Cnt=0;Cnt<DISP_LEN;Cnt++)
+	//for(Cnt=0;Cnt<_LOC_LEN;Cnt++)
 	//{
-	//	_loc_DispData[Cnt]='B'+Cnt;
+	//	_loc_D->Data[Cnt]='B'+Cnt;
 	//}
 	
 	
@@ -1020,13 +1379,48 @@ void display_Test(void)
 }
 
 // Ausgabe eines Strings auf dem Display. keine Prfung des Speichers
+// Der Teil des Textes, der ohne CR/LF in die aktuelle Zeile passt, wird in einem
+// Schritt in den Anzeigespeicher kopiert und als ein Block an den Controller bertragen.
+// Nur am Zeilenende und bei CR/LF wird display_CharToDisplay verwendet.
 void display_TxtToDisplay(char *txt, unsigned char len)
 {
-	unsigned char cnt;
+	unsigned char cnt = 0;
+	uint8_t Run, Max;
 	
-	for(cnt=0;cnt<len;cnt++)
+	while (cnt<len)
 	{
-		display_CharToDisplay(txt[cnt]);
+		// Lnge des Blocks bis zum Zeilenende oder zum nchsten Steuerzeichen
+		Run=0;
+		if (_loc_D->X<_LOC_COLS)
+		{
+			Max=_LOC_COLS-_loc_D->X;
+			if (Max>(len-cnt)) Max=len-cnt;
+			while ((Run<Max) && (txt[cnt+Run]!=ASCII_CR) && (txt[cnt+Run]!=ASCII_LF)) Run++;
+		}
+		
+		if (Run)
+		{
+			if (!_loc_D->HwCursorOk)
+			{
+				_LOC_HW_POS(_loc_D->X,_loc_D->Y);
+				_loc_D->HwCursorOk=1;
+			}
+			
+			_LOC_HW_TXT((uint8_t *)&txt[cnt],Run);
+			for (Max=0;Max<Run;Max++)
+			{
+				_loc_D->Data[_loc_D->Ix+Max]=txt[cnt+Max];
+			}
+			_loc_D->X+=Run;
+			_loc_D->Ix+=Run;
+			cnt+=Run;
+		}
+		else
+		{
+			// Zeilenumbruch, Scrollen und Steuerzeichen
+			display_CharToDisplay(txt[cnt]);
+			cnt++;
+		}
 	}
 }
 
@@ -1068,5 +1462,487 @@ void display_UintToDisplay(uint32_t x, char N)
 }
 
 
+// Ein numerisches Feld anlegen
+// Ungltige IDs oder Felder, die nicht in die Zeile passen, werden ignoriert
+void display_FieldDefine(uint8_t id, uint8_t x, uint8_t y, uint8_t width, uint8_t fmt)
+{
+	uint8_t MinWidth;
+	
+	// Mindestens eine Ziffer, dazu Vorzeichen, Komma und Nachkommastellen
+	MinWidth=1+((fmt & DISP_FMT_INT)?1:0)+((fmt & 0x03)?((fmt & 0x03)+1):0);
+	
+	if ((id<DISP_FIELDS) && (y<_LOC_LINES) && (width>=MinWidth) && (width<=10) && ((x+width)<=_LOC_COLS))
+	{
+		_loc_D->Fields[id].Ix=y*_LOC_COLS+x;
+		_loc_D->Fields[id].Width=width;
+		_loc_D->Fields[id].Fmt=fmt;
+	}
+}
+
+// Den Wert eines Feldes formatieren und nur die genderten Stellen ausgeben
+// Der Text wird zuerst komplett im Puffer aufgebaut und mit dem Anzeigespeicher
+// verglichen. bertragen wird der Bereich von der ersten bis zur letzten Abweichung.
+void display_FieldSet(uint8_t id, int32_t value)
+{
+	char Text[10];
+
+	if ((id>=DISP_FIELDS) || (_loc_D->Fields[id].Width==0)) return;
+
+	_loc_FieldText(Text,value,_loc_D->Fields[id].Width,_loc_D->Fields[id].Fmt);
+	_loc_Update(_loc_D->Fields[id].Ix,(uint8_t *)Text,_loc_D->Fields[id].Width);
+}
+
+// Einen Wert mit Width Stellen im Format Fmt (DISP_FMT_xxx) in Text aufbereiten
+// Passt der Wert nicht, wird Text mit '*' gefllt
+static void _loc_FieldText(char *Text, int32_t value, uint8_t Width, uint8_t Fmt)
+{
+	uint8_t Dec, Cnt, First, Last;
+	uint8_t Neg = 0;
+	uint32_t x, Limit;
+
+	Dec=Fmt & 0x03;
+	
+	x=value;
+	if ((Fmt & DISP_FMT_INT) && (value<0))
+	{
+		Neg=1;
+		x=-value;
+	}
+	
+	// Ziffern inkl. fhrender Nullen erzeugen, Platz fr Komma und Vorzeichen lassen
+	Cnt=Width-(Dec?1:0)-Neg;
+	_loc_uint2txt(x,Text+Width-Cnt,Cnt);
+	
+	// Passt der Wert nicht, wird das Feld mit '*' markiert statt abgeschnitten
+	Limit=1;
+	for (First=0;First<Cnt;First++) Limit*=10;
+	if ((Cnt<10) && (x>=Limit))
+	{
+		for (Cnt=0;Cnt<Width;Cnt++) Text[Cnt]='*';
+	}
+	else
+	{
+		// Komma einfgen: die Ziffern vor dem Komma um eine Stelle nach links schieben
+		if (Dec)
+		{
+			for (Cnt=Neg;Cnt<(Width-Dec-1);Cnt++) Text[Cnt]=Text[Cnt+1];
+			Text[Width-Dec-1]='.';
+		}
+		
+		// Fhrende Nullen durch Leerzeichen ersetzen, die Stelle vor dem Komma bleibt
+		First=Neg;
+		if (!(Fmt & DISP_FMT_ZERO))
+		{
+			Last=Width-1-(Dec?(Dec+1):0);
+			while ((First<Last) && (Text[First]=='0'))
+			{
+				Text[First]=' ';
+				First++;
+			}
+		}
+		
+		// Vorzeichen direkt vor der ersten Ziffer
+		if (Neg)
+		{
+			Text[0]=' ';
+			Text[First-1]='-';
+		}
+	}
+}
+
+#if defined(DISP_NOKIA) && defined(DISP_BIGNUM)
+// Eine groe Zahl anlegen, fmt wie bei display_FieldDefine aber ohne Nachkommastellen
+void display_BigDefine(uint8_t id, uint8_t x, uint8_t y, uint8_t digits, uint8_t fmt)
+{
+	if (_LOC_IS_NOKIA && (id<DISP_BIGNUMS) && (digits>=1) && (digits<=(_LOC_COLS/DISP_BIG_WIDTH)) && !(fmt & 0x03) &&
+		((x+digits*DISP_BIG_WIDTH)<=_LOC_COLS) && ((y+DISP_BIG_HEIGHT)<=_LOC_LINES))
+	{
+		_loc_D->Bigs[id].Ix=y*_LOC_COLS+x;
+		_loc_D->Bigs[id].Digits=digits;
+		_loc_D->Bigs[id].Fmt=fmt;
+	}
+}
+
+// Eine groe Zahl ausgeben
+// Jede Ziffer wird in ihre Zeichenstellen zerlegt und bankweise mit dem Anzeigespeicher
+// verglichen, bertragen werden nur die Stellen der Ziffern, die sich gendert haben.
+void display_BigSet(uint8_t id, int32_t value)
+{
+	char Text[DISP_NOKIA_COLS/DISP_BIG_WIDTH];
+	uint8_t Cells[DISP_NOKIA_COLS];
+	uint8_t Digits, Cnt, Bank, Part, d;
+
+	if ((id>=DISP_BIGNUMS) || (_loc_D->Bigs[id].Digits==0)) return;
+
+	Digits=_loc_D->Bigs[id].Digits;
+	_loc_FieldText(Text,value,Digits,_loc_D->Bigs[id].Fmt);
+	
+	// Zeichen auf die Glyphen abbilden, ein berlauf ('*') wird als '-' angezeigt
+	for (Cnt=0;Cnt<Digits;Cnt++)
+	{
+		d=Text[Cnt];
+		if ((d>='0') && (d<='9')) d-='0';
+		else if (d==' ') d=DISP_BIG_SPACE;
+		else d=DISP_BIG_MINUS;
+		Text[Cnt]=d;
+	}
+	
+	for (Bank=0;Bank<DISP_BIG_HEIGHT;Bank++)
+	{
+		for (Cnt=0;Cnt<Digits;Cnt++)
+		{
+			for (Part=0;Part<DISP_BIG_WIDTH;Part++)
+			{
+				Cells[Cnt*DISP_BIG_WIDTH+Part]=DISP_BIG_CODE+(Text[Cnt]*DISP_BIG_HEIGHT+Bank)*DISP_BIG_WIDTH+Part;
+			}
+		}
+		_loc_Update(_loc_D->Bigs[id].Ix+Bank*_LOC_COLS,Cells,Digits*DISP_BIG_WIDTH);
+	}
+}
+#endif
+
+#ifdef DISP_MEGACARD
+// Einen Balken anlegen, die CGRAM-Stelle wird beim ersten display_BarSet geladen
+void display_BarDefine(uint8_t id, uint8_t x, uint8_t y, uint8_t width)
+{
+	if (_LOC_IS_LCD && (id<DISP_BARS) && (y<_LOC_LINES) && (width>0) && ((x+width)<=_LOC_COLS))
+	{
+		_loc_D->Bars[id].Ix=y*_LOC_COLS+x;
+		_loc_D->Bars[id].Width=width;
+		_loc_D->Bars[id].Glyph=0xFF;
+		_loc_D->Bars[id].Loaded=0xFF;
+	}
+}
+
+// Den Balken auf value/full setzen
+// Volle Stellen sind das ROM-Zeichen 0xFF, leere Stellen ein Leerzeichen, die
+// angebrochene Stelle zeigt das CGRAM-Zeichen des Balkens. Gendert werden nur die
+// Stellen, die sich unterscheiden, und das CGRAM-Zeichen wenn seine Pixelzahl wechselt.
+void display_BarSet(uint8_t id, uint16_t value, uint16_t full)
+{
+	uint8_t Text[DISP_LCD_COLS];
+	uint8_t Width, Cnt, Cells, Part;
+	uint16_t Px;
+	
+	if ((id>=DISP_BARS) || (_loc_D->Bars[id].Width==0) || (full==0)) return;
+	
+	Width=_loc_D->Bars[id].Width;
+	if (value>=full)
+	{
+		Px=Width*DISP_BAR_PX;
+	}
+	else
+	{
+		Px=((uint32_t)value*(Width*DISP_BAR_PX)+full/2)/full;
+	}
+	Cells=Px/DISP_BAR_PX;
+	Part=Px%DISP_BAR_PX;
+	
+	for (Cnt=0;Cnt<Width;Cnt++)
+	{
+		if (Cnt<Cells) Text[Cnt]=0xFF;
+		else if ((Cnt==Cells) && Part) Text[Cnt]=DISP_BAR_CODE(id);
+		else Text[Cnt]=' ';
+	}
+	
+	// Das CGRAM-Zeichen nur bei einer anderen Pixelzahl neu laden. Die Zelle mit dem
+	// Zeichen muss dafr nicht neu geschrieben werden, der Controller zeigt es sofort an.
+	if (Part)
+	{
+		_loc_D->Bars[id].Glyph=Part;
+#ifndef DISP_BACKBUFFER
+		_loc_BarLoad(id);
+#else
+		_loc_D->Dirty=1;
+#endif
+	}
+	
+	_loc_Update(_loc_D->Bars[id].Ix,Text,Width);
+}
+
+// Das CGRAM-Zeichen eines Balkens laden, falls es nicht mehr dem Sollzustand entspricht
+// Die Pixel fllen die Stelle von links: n Pixel -> die oberen n der 5 Spalten-Bits
+static void _loc_BarLoad(uint8_t id)
+{
+	uint8_t Glyph = _loc_D->Bars[id].Glyph;
+	
+	if ((_loc_D->Bars[id].Width==0) || (Glyph==0xFF) || (Glyph==_loc_D->Bars[id].Loaded)) return;
+	_hw_CgWrite(id,(0x1F<<(DISP_BAR_PX-Glyph))&0x1F);
+	_loc_D->Bars[id].Loaded=Glyph;
+	_loc_D->HwCursorOk=0;
+}
+#endif
+
+// Den Anzeigespeicher ab Ix mit Text vergleichen und nur den Bereich von der ersten
+// bis zur letzten Abweichung mit einem Cursor-Sprung am Stck bertragen
+static void _loc_Update(uint8_t Ix, const uint8_t *Text, uint8_t Width)
+{
+	uint8_t Cnt, First, Last;
+	
+	// Erste und letzte Abweichung zum Anzeigespeicher suchen
+	First=0xFF;
+	Last=0;
+	for (Cnt=0;Cnt<Width;Cnt++)
+	{
+		if (_loc_D->Data[Ix+Cnt]!=Text[Cnt])
+		{
+			if (First==0xFF) First=Cnt;
+			Last=Cnt;
+		}
+	}
+	if (First==0xFF) return;
+	
+	// Ein Cursor-Sprung, danach der genderte Bereich am Stck
+	Ix+=First;
+	_LOC_HW_POS(Ix%_LOC_COLS,Ix/_LOC_COLS);
+	_LOC_HW_TXT(&Text[First],Last-First+1);
+	for (Cnt=First;Cnt<=Last;Cnt++)
+	{
+		_loc_D->Data[Ix]=Text[Cnt];
+		Ix++;
+	}
+	_loc_D->HwCursorOk=0;
+}
+
+
+// nderungen seit dem letzten Aufruf an das Display bertragen
+// Pro Zeile wird jeder zusammenhngende Lauf genderter Zeichen mit einem
+// Cursor-Sprung und einem Block bertragen, unvernderte Zeichen nie.
+uint8_t display_Commit(void)
+{
+	uint8_t Sent = 0;
+#ifdef DISP_BACKBUFFER
+	uint8_t Line, Ix, Cnt, First;
+	
+	if (!_loc_D->Dirty || !_loc_D->Ready) return 0;
+	_loc_D->Dirty=0;
+	
+#ifdef DISP_MEGACARD
+	// Zuerst die CGRAM-Zeichen, damit die Balken-Stellen gleich richtig erscheinen
+	for (Cnt=0;Cnt<DISP_BARS;Cnt++)
+	{
+		_loc_BarLoad(Cnt);
+	}
+#endif
+	
+	Ix=0;
+	for (Line=0;Line<_LOC_LINES;Line++)
+	{
+		Cnt=0;
+		while (Cnt<_LOC_COLS)
+		{
+			if (_loc_D->Data[Ix+Cnt]==_loc_D->Shown[Ix+Cnt])
+			{
+				Cnt++;
+				continue;
+			}
+			
+			// Lauf genderter Zeichen bis zum ersten unvernderten oder zum Zeilenende
+			First=Cnt;
+			while ((Cnt<_LOC_COLS) && (_loc_D->Data[Ix+Cnt]!=_loc_D->Shown[Ix+Cnt]))
+			{
+				_loc_D->Shown[Ix+Cnt]=_loc_D->Data[Ix+Cnt];
+				Cnt++;
+			}
+			_hw_Pos(First,Line);
+			_hw_TxtToDisplay(&_loc_D->Shown[Ix+First],Cnt-First);
+			Sent+=Cnt-First;
+		}
+		Ix+=_LOC_COLS;
+	}
+#endif
+	return Sent;
+}
+
+
+// Zahl in Ziffern zerlegen, die Ziffern stehen danach in umgekehrter Reihenfolge in Buf
+// Werte bis 0xFFFF werden mit 16-Bit Arithmetik gerechnet, das spart viele Zyklen.
+// Rckgabe: Anzahl der Ziffern (mindestens 1)
+static uint8_t _loc_FmtDigits(char *Buf, uint32_t x, uint8_t Hex)
+{
+	uint8_t n = 0;
+	uint8_t d;
+	uint16_t w;
+	
+	if (Hex)
+	{
+		do
+		{
+			d=x & 0x0F;
+			Buf[n++]=(d<10)?('0'+d):('a'-10+d);
+			x>>=4;
+		} while (x);
+		return n;
+	}
+	
+	while (x>0xFFFF)
+	{
+		Buf[n++]='0'+(x%10);
+		x/=10;
+	}
+	w=x;
+	do
+	{
+		Buf[n++]='0'+(w%10);
+		w/=10;
+	} while (w);
+	
+	return n;
+}
+
+// Gemeinsamer Formatierer fr display_Printf und display_Printf_P
+// Der Zeilenpuffer wird bei CR/LF, wenn er voll ist und am Ende an das Display bergeben.
+#define _LOC_LINE_PUT(ch) do { if (Len>=_LOC_COLS) { display_TxtToDisplay(Line,Len); Len=0; } Line[Len++]=(ch); } while (0)
+
+static void _loc_Vprintf(const char *fmt, uint8_t Flash, va_list ap)
+{
+	char Line[DISP_COLS_MAX];
+	char Num[11];
+	uint8_t Len = 0;
+	char c;
+	uint8_t Width, Prec, Long, Zero, Left, Neg, n, Pad;
+	uint32_t x;
+	const char *s;
+	
+	for (;;)
+	{
+		c=Flash?pgm_read_byte(fmt):*fmt;
+		fmt++;
+		if (c==0) break;
+		
+		if (c!='%')
+		{
+			if ((c==ASCII_CR) || (c==ASCII_LF))
+			{
+				display_TxtToDisplay(Line,Len);
+				Len=0;
+				display_CharToDisplay(c);
+			}
+			else
+			{
+				_LOC_LINE_PUT(c);
+			}
+		}
+		else
+		{
+			// Format-Angabe zerlegen: Flags, Breite, Nachkommastellen, Lnge
+			Width=0; Prec=0; Long=0; Zero=0; Left=0; Neg=0;
+			c=Flash?pgm_read_byte(fmt):*fmt; fmt++;
+			if (c=='-') { Left=1; c=Flash?pgm_read_byte(fmt):*fmt; fmt++; }
+			if (c=='0') { Zero=1; c=Flash?pgm_read_byte(fmt):*fmt; fmt++; }
+			while ((c>='0') && (c<='9'))
+			{
+				Width=Width*10+(c-'0');
+				c=Flash?pgm_read_byte(fmt):*fmt; fmt++;
+			}
+			if (c=='.')
+			{
+				c=Flash?pgm_read_byte(fmt):*fmt; fmt++;
+				while ((c>='0') && (c<='9'))
+				{
+					Prec=Prec*10+(c-'0');
+					c=Flash?pgm_read_byte(fmt):*fmt; fmt++;
+				}
+			}
+			if (c=='l') { Long=1; c=Flash?pgm_read_byte(fmt):*fmt; fmt++; }
+			
+			n=0;
+			s=Num;
+			switch (c)
+			{
+				case 'c':
+					Num[0]=(char)va_arg(ap,int);
+					n=1;
+				break;
+				
+				case 's':
+					s=va_arg(ap,const char *);
+					while (s[n]) n++;
+				break;
+				
+				case 'd':
+					x=Long?(uint32_t)va_arg(ap,int32_t):(uint32_t)(int32_t)va_arg(ap,int);
+					if ((int32_t)x<0)
+					{
+						Neg=1;
+						x=-x;
+					}
+					n=_loc_FmtDigits(Num,x,0);
+				break;
+				
+				case 'u':
+				case 'x':
+					x=Long?va_arg(ap,uint32_t):(uint32_t)va_arg(ap,unsigned int);
+					n=_loc_FmtDigits(Num,x,c=='x');
+				break;
+				
+				case 0:
+					// Formatstring endet mitten in der Angabe
+					fmt--;
+				break;
+				
+				default:
+					// %% und unbekannte Angaben werden unverndert ausgegeben
+					Num[0]=c;
+					n=1;
+				break;
+			}
+			
+			// Festkomma: mindestens Prec+1 Ziffern, Komma vor den letzten Prec Ziffern
+			if (Prec && ((c=='d') || (c=='u')))
+			{
+				if (Prec>4) Prec=4;
+				while (n<=Prec) Num[n++]='0';
+				for (Pad=n;Pad>Prec;Pad--) Num[Pad]=Num[Pad-1];
+				Num[Prec]='.';
+				n++;
+			}
+			
+			// Auffllen auf die Breite, Ziffern stehen in Num rckwrts
+			Pad=((n+Neg)<Width)?(Width-n-Neg):0;
+			if (Left) Zero=0;
+			if (Neg && Zero) _LOC_LINE_PUT('-');
+			if (!Left)
+			{
+				for (;Pad;Pad--) _LOC_LINE_PUT(Zero?'0':' ');
+			}
+			if (Neg && !Zero) _LOC_LINE_PUT('-');
+			if (s==Num)
+			{
+				while (n) _LOC_LINE_PUT(Num[--n]);
+			}
+			else
+			{
+				for (;n;n--) _LOC_LINE_PUT(*s++);
+			}
+			for (;Pad;Pad--) _LOC_LINE_PUT(' ');
+		}
+	}
+	
+	display_TxtToDisplay(Line,Len);
+}
+#undef _LOC_LINE_PUT
+
+// Formatierte Ausgabe, Formatstring im RAM
+void display_Printf(const char *fmt, ...)
+{
+	va_list ap;
+	
+	va_start(ap,fmt);
+	_loc_Vprintf(fmt,0,ap);
+	va_end(ap);
+}
+
+// Formatierte Ausgabe, Formatstring im Flash
+void display_Printf_P(const char *fmt, ...)
+{
+	va_list ap;
+	
+	va_start(ap,fmt);
+	_loc_Vprintf(fmt,1,ap);
+	va_end(ap);
+}
+
+
 /* Ende der Bibliotheksfunktionen                                         */
 /**************************************************************************/
\ No newline at end of file
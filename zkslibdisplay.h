@@ -12,6 +12,7 @@
 #define ZKSLIBDISPLAY 202105
 
 #include <stdint.h>
+#include "messcfg.h"
 
 #define ASCII_CR 0x0d
 #define ASCII_LF 0x0a
@@ -29,9 +30,29 @@
 #define DISP_DB6				6
 #define DISP_DB7				7
 
-#define DISP_LINES 2
-#define DISP_COLS 8
-#define DISP_LEN (DISP_LINES*DISP_COLS)
+// 8-Bit Bus (DISP_BUS8 als Symbol definieren)
+// DB0..DB7 liegen auf einem ganzen freien Port, RS und EN bleiben auf PORTA.
+// Ein Byte wird mit einem Port-Schreibzugriff und einem EN-Puls bertragen statt
+// mit zwei Halbbytes. PORTB ist wegen OC0 (PB3, Motor-PWM) nicht nutzbar.
+// Bei PORTC muss JTAG abgeschaltet sein (JTAGEN-Fuse), sonst belegt es PC2..PC5.
+#ifdef DISP_BUS8
+#ifdef DISP_MC_NEU
+#error "DISP_BUS8 geht nicht zusammen mit DISP_MC_NEU"
+#endif
+#ifndef DISP_PORT8
+#define DISP_PORT8 PORTC
+#define DISP_PORT8_PORTC	// Standardport, main.c prft dann auf berschneidungen
+#endif
+#ifndef DISP_DDR8
+#define DISP_DDR8 DDRC
+#endif
+#endif
+
+#define DISP_LCD_LINES 2
+#define DISP_LCD_COLS 8
+
+// Anzahl Schritte der Init-Statemachine
+#define DISP_LCD_INIT_STAGES 6
 
 #endif
 
@@ -39,16 +60,79 @@
 
 /* Defines fr das Nokia LC Display */
 #define NOKIA_SPI_CHANNEL 0
+// Steuerleitungen, einzeln berschreibbar. CS schaltet die SPI-Schnittstelle,
+// NOKIA_CS_BIT wird vom Treiber nicht angesteuert.
+#ifndef NOKIA_CONTROL_PORT
 #define NOKIA_CONTROL_PORT PORTD
+#define NOKIA_CONTROL_PORTD		// Standardport, main.c prft dann auf belegte Eingnge
+#endif
+#ifndef NOKIA_DDR_PORT
 #define NOKIA_DDR_PORT DDRD
+#endif
+#ifndef NOKIA_CD_BIT
 #define NOKIA_CD_BIT 5
+#endif
+#ifndef NOKIA_CS_BIT
 #define NOKIA_CS_BIT 6
+#endif
+// Mit DISP_MULTI luft das Nokia neben der Messung, PD6 (ICP1) und PD7 (Lichtschranke)
+// bleiben dann Eingnge und RST liegt auf dem freien PD4
+#ifndef NOKIA_RST_BIT
+#ifdef DISP_MULTI
+#define NOKIA_RST_BIT 4
+#else
 #define NOKIA_RST_BIT 7
+#endif
+#endif
+
+
+#define DISP_NOKIA_LINES 6
+#define DISP_NOKIA_COLS 9
+
+// Anzahl Schritte der Init-Statemachine (Reset, Kommandos, 6 Bnke lschen)
+#define DISP_NOKIA_INIT_STAGES 10
+
+#endif
 
+// Eine Anzeige (Standard) oder mehrere gleichzeitig (DISP_MULTI als Symbol definieren)
+// Ohne DISP_MULTI ist genau ein Typ eingebunden, alle Funktionen greifen direkt auf
+// ihn zu. Mit DISP_MULTI drfen DISP_MEGACARD und DISP_NOKIA zusammen definiert sein,
+// DISP_LINES/DISP_COLS gibt es dann nicht, die Grsse steht in der Instanz.
+#ifndef DISP_MULTI
 
-#define DISP_LINES 6
-#define DISP_COLS 9
+#if defined(DISP_MEGACARD) && defined(DISP_NOKIA)
+#error "DISP_MEGACARD und DISP_NOKIA gleichzeitig nur mit DISP_MULTI"
+#endif
+
+#if defined(DISP_MEGACARD)
+#define DISP_LINES DISP_LCD_LINES
+#define DISP_COLS DISP_LCD_COLS
+#define DISP_INIT_STAGES DISP_LCD_INIT_STAGES
+#elif defined(DISP_NOKIA)
+#define DISP_LINES DISP_NOKIA_LINES
+#define DISP_COLS DISP_NOKIA_COLS
+#define DISP_INIT_STAGES DISP_NOKIA_INIT_STAGES
+#endif
 #define DISP_LEN (DISP_LINES*DISP_COLS)
+#define DISP_COLS_MAX DISP_COLS
+
+#else
+
+// Grsste Werte der eingebundenen Typen (Puffer auf dem Stack, Tabelle der Init-Zeiten)
+#if defined(DISP_MEGACARD) && defined(DISP_NOKIA)
+// Das Nokia belegt den SPI-Bus an PB5..PB7, dort liegen auch DB5..DB7 des 4-Bit Busses
+#if !defined(DISP_BUS8) && !defined(DISP_MC_NEU)
+#error "HD44780 und Nokia zusammen: das HD44780 braucht DISP_BUS8 oder DISP_MC_NEU"
+#endif
+#define DISP_COLS_MAX ((DISP_LCD_COLS>DISP_NOKIA_COLS)?DISP_LCD_COLS:DISP_NOKIA_COLS)
+#define DISP_INIT_STAGES ((DISP_LCD_INIT_STAGES>DISP_NOKIA_INIT_STAGES)?DISP_LCD_INIT_STAGES:DISP_NOKIA_INIT_STAGES)
+#elif defined(DISP_MEGACARD)
+#define DISP_COLS_MAX DISP_LCD_COLS
+#define DISP_INIT_STAGES DISP_LCD_INIT_STAGES
+#elif defined(DISP_NOKIA)
+#define DISP_COLS_MAX DISP_NOKIA_COLS
+#define DISP_INIT_STAGES DISP_NOKIA_INIT_STAGES
+#endif
 
 #endif
 
@@ -56,9 +140,29 @@
 //HW Unabhngige Funktionsprototypen fr die Display-Steuerung
 //Diese Funktionen sind immer gleich, unabhngig vom Typ des Displays.
 
+// Dauer eines Ticks fr die nicht-blockierende Initialisierung in us
+// Muss zum Tick-Zhler passen, der an display_InitTask bergeben wird,
+// Standard ist der Abtast-Tick der Messung (messcfg.h).
+#ifndef DISP_TICK_US
+#define DISP_TICK_US (1000000UL/MESS_TICK_HZ)
+#endif
+
 // Konfigurieren des Displays und der Leitungen
+// Blockiert fr die Dauer der Initialisierung (HD44780 ca. 60 ms, Nokia ca. 210 ms)
 void display_Init(void);
 
+// Nicht-blockierende Initialisierung
+// display_InitStart einmal aufrufen, danach display_InitTask regelmssig (z.B. in der
+// Hauptschleife) mit dem aktuellen Tick-Zhler aufrufen, bis 1 zurckgegeben wird.
+// Die Wartezeiten des Controllers laufen dabei im Hintergrund ab.
+// Vorher drfen keine anderen display_ Funktionen aufgerufen werden.
+void display_InitStart(uint16_t now);
+uint8_t display_InitTask(uint16_t now);
+
+// Zeitpunkt in Ticks (relativ zu display_InitStart) an dem der Init-Schritt stage
+// ausgefhrt wurde, 0xFFFF wenn noch nicht. Dient der Messung der Boot-Zeit.
+uint16_t display_InitStageTime(uint8_t stage);
+
 // Den Cursor an die Position (0,0) verschieben
 void display_Home(void);
 
@@ -102,4 +206,219 @@ void display_UintToDisplay(uint32_t x, char N);
 // Zeilenumbruch und Scrollen
 void display_TxtToDisplay(char *txt, unsigned char len);
 
+// Numerische Felder (Feld-API)
+// Ein Feld ist ein fester Bereich im Display, der ber eine ID angesprochen wird.
+// Die statischen Beschriftungen werden einmal mit display_Pos/display_TxtToDisplay
+// geschrieben, danach werden nur noch die Felder mit display_FieldSet aktualisiert.
+// Es werden nur die Stellen bertragen, die sich gegenber dem Anzeigespeicher
+// gendert haben (ein Cursor-Sprung, danach ein zusammenhngender Lauf).
+#ifndef DISP_FIELDS
+#define DISP_FIELDS 4
+#endif
+
+// Formate fr display_FieldDefine, knnen mit | kombiniert werden
+// Die unteren zwei Bits geben die Anzahl Nachkommastellen an (Festkomma)
+#define DISP_FMT_UINT		0x00	// ohne Vorzeichen, rechtsbndig mit Leerzeichen
+#define DISP_FMT_INT		0x40	// mit Vorzeichen, '-' direkt vor der ersten Ziffer
+#define DISP_FMT_ZERO		0x80	// fhrende Nullen statt Leerzeichen
+#define DISP_FMT_DEC(n)		((n)&0x03)	// Festkomma mit n Nachkommastellen
+
+// Ein Feld an Position (x,y) mit width Stellen (inkl. Vorzeichen und Komma) anlegen.
+// Das Feld muss vollstndig in der Zeile Platz haben, sonst wird es nicht angelegt.
+// Der Inhalt des Displays wird dabei nicht verndert.
+void display_FieldDefine(uint8_t id, uint8_t x, uint8_t y, uint8_t width, uint8_t fmt);
+
+// Einen neuen Wert im Feld id anzeigen. Nur die genderten Stellen werden bertragen.
+// Passt der Wert nicht in das Feld, wird das Feld mit '*' gefllt.
+// Die aktuelle Cursor-Position fr die brigen Ausgaben bleibt erhalten.
+void display_FieldSet(uint8_t id, int32_t value);
+
+#ifdef DISP_MEGACARD
+// Balkenanzeige (nur HD44780)
+// Ein Balken belegt width Stellen ab (x,y), jede Stelle ist in DISP_BAR_PX Pixel unterteilt.
+// Volle Stellen zeigen das ROM-Zeichen 0xFF, leere ein Leerzeichen. Fr die angebrochene
+// Stelle hat jeder Balken ein eigenes CGRAM-Zeichen (Slot = id), deshalb DISP_BARS <= 8.
+// ndert sich der Wert, wird nur das CGRAM-Zeichen (9 Bytes, nur bei anderer Pixelzahl)
+// und die genderten Stellen bertragen, ohne Neuaufbau der Seite.
+#ifndef DISP_BARS
+#define DISP_BARS 1
+#endif
+#if DISP_BARS > 8
+#error "DISP_BARS: der HD44780 hat nur 8 CGRAM-Zeichen"
+#endif
+#define DISP_BAR_PX 5
+
+// Code der angebrochenen Stelle im Anzeigespeicher: 8..15 sind Spiegel der
+// CGRAM-Zeichen 0..7, so steht nie eine 0 im Speicher
+#define DISP_BAR_CODE(id) (0x08|(id))
+
+// Einen Balken an Position (x,y) mit width Stellen anlegen.
+// Der Balken muss vollstndig in der Zeile Platz haben, sonst wird er nicht angelegt.
+void display_BarDefine(uint8_t id, uint8_t x, uint8_t y, uint8_t width);
+
+// Den Balken auf value/full der Lnge setzen (auf ganze Pixel gerundet, begrenzt auf full)
+// Die aktuelle Cursor-Position fr die brigen Ausgaben bleibt erhalten.
+void display_BarSet(uint8_t id, uint16_t value, uint16_t full);
+#endif
+
+#if defined(DISP_NOKIA) && defined(DISP_BIGNUM)
+// Groe Ziffern (nur Nokia, DISP_BIGNUM als Symbol definieren)
+// Die Ziffern des 7x8 Fonts werden schon beim bersetzen auf DISP_BIG_HEIGHT (2 oder 3)
+// Bnke Hhe und DISP_BIG_WIDTH (1 oder 2) Zeichen Breite vergrert und liegen im Flash.
+// Eine Ziffer belegt DISP_BIG_WIDTH x DISP_BIG_HEIGHT Zeichenstellen des Anzeigespeichers,
+// Clear, Back-Buffer und Scrollen behandeln sie wie normale Zeichen.
+#ifndef DISP_BIG_HEIGHT
+#define DISP_BIG_HEIGHT 3
+#endif
+#ifndef DISP_BIG_WIDTH
+#define DISP_BIG_WIDTH 1
+#endif
+#ifndef DISP_BIGNUMS
+#define DISP_BIGNUMS 1
+#endif
+#if ((DISP_BIG_HEIGHT!=2) && (DISP_BIG_HEIGHT!=3)) || ((DISP_BIG_WIDTH!=1) && (DISP_BIG_WIDTH!=2))
+#error "DISP_BIG_HEIGHT muss 2 oder 3, DISP_BIG_WIDTH 1 oder 2 sein"
+#endif
+
+// Eine groe Zahl mit digits Ziffern ab der Zeichenstelle (x,y) anlegen
+// fmt wie bei display_FieldDefine, Nachkommastellen werden nicht untersttzt.
+// Die Zahl muss vollstndig ins Display passen, sonst wird sie nicht angelegt.
+void display_BigDefine(uint8_t id, uint8_t x, uint8_t y, uint8_t digits, uint8_t fmt);
+
+// Einen neuen Wert anzeigen. bertragen werden nur die Ziffern, die sich gendert haben,
+// jeweils in allen Bnken der Ziffer. Passt der Wert nicht, erscheinen nur '-'.
+void display_BigSet(uint8_t id, int32_t value);
+#endif
+
+// Formatierte Ausgabe an der aktuellen Cursor-Position ohne stdio/vfprintf
+// Der Text wird zeilenweise in einem Puffer aufgebaut und pro Zeile als ein
+// zusammenhngender Lauf an das Display bergeben. CR und LF wirken wie bei display_CharToDisplay.
+// Untersttzte Angaben: %c %s %u %d %x %%
+// Flags und Breite: %5u (rechtsbndig), %-5u (linksbndig), %05u (fhrende Nullen)
+// 'l' fr 32-Bit Werte: %lu %ld %lx
+// Festkomma: %.2u bzw. %.1d gibt den ganzzahligen Wert mit n Nachkommastellen aus (1234 -> 12.34)
+void display_Printf(const char *fmt, ...);
+
+// Wie display_Printf, der Formatstring liegt aber im Flash (PSTR("..."))
+void display_Printf_P(const char *fmt, ...);
+
+// Back-Buffer (DISP_BACKBUFFER als Symbol definieren)
+// Alle Ausgabefunktionen schreiben dann nur noch in den Anzeigespeicher. display_Commit
+// vergleicht ihn mit dem zuletzt bertragenen Inhalt und schickt pro Zeile nur die
+// genderten Lufe zum Display. So kann ein Bild in mehreren Schritten aufgebaut werden,
+// ohne dass Zwischenstnde oder unvernderte Zeichen ber den Bus gehen.
+// Kostet DISP_LEN Bytes RAM. Ohne DISP_BACKBUFFER ist display_Commit leer.
+// Rckgabe: Anzahl bertragener Zeichen, 0 wenn nichts gesendet wurde
+uint8_t display_Commit(void);
+
+// Zustand einer Anzeige
+// Ohne DISP_MULTI gibt es genau eine Instanz in zkslibdisplay.c, auf die alle Funktionen
+// direkt (ber feste Adressen) zugreifen. Mit DISP_MULTI legt der Aufrufer die Instanzen
+// und ihre Anzeigespeicher an und whlt mit display_Select, welche die Funktionen bedienen.
+#ifdef DISP_MULTI
+// Funktionstabelle eines Display-Typs (eine pro Typ, nicht pro Instanz)
+typedef struct
+{
+	uint16_t (*InitStep)(uint8_t Stage);
+	void (*Pos)(uint8_t x, uint8_t y);
+	void (*Home)(void);
+	void (*CharToDisplay)(uint8_t c);
+	void (*TxtToDisplay)(const uint8_t *txt, uint8_t len);
+	uint8_t Lines;
+	uint8_t Cols;
+} display_ops_t;
+#endif
+
+typedef struct
+{
+#ifdef DISP_MULTI
+	const display_ops_t *Ops;
+	uint8_t *Data;					// Anzeigespeicher (Lines*Cols)
+#ifdef DISP_BACKBUFFER
+	uint8_t *Shown;					// Inhalt des Displays beim letzten display_Commit
+#endif
+	uint8_t Lines;
+	uint8_t Cols;
+	uint8_t Len;
+#else
+	uint8_t Data[DISP_LEN];
+#ifdef DISP_BACKBUFFER
+	uint8_t Shown[DISP_LEN];
+#endif
+#endif
+#ifdef DISP_BACKBUFFER
+	uint8_t Dirty;
+#endif
+	uint8_t Ix;						// Cursor als Index in Data
+	uint8_t X;
+	uint8_t Y;
+	uint8_t HwCursorOk;				// 1 = der HW-Cursor steht auf X/Y
+	
+	// Nicht-blockierende Initialisierung (siehe display_InitTask)
+	uint8_t InitStage;
+	uint8_t Ready;
+	uint16_t InitStart;
+	uint16_t InitDue;
+	uint16_t InitTime[DISP_INIT_STAGES];
+	
+	// Numerische Felder (siehe display_FieldDefine)
+	struct
+	{
+		uint8_t Ix;					// Index des ersten Zeichens im Anzeigespeicher
+		uint8_t Width;				// Anzahl Stellen, 0 = Feld nicht angelegt
+		uint8_t Fmt;				// DISP_FMT_xxx
+	} Fields[DISP_FIELDS];
+#if defined(DISP_NOKIA) && defined(DISP_BIGNUM)
+	// Groe Zahlen (siehe display_BigDefine)
+	struct
+	{
+		uint8_t Ix;					// Index der linken oberen Zeichenstelle im Anzeigespeicher
+		uint8_t Digits;				// Anzahl Ziffern, 0 = nicht angelegt
+		uint8_t Fmt;				// DISP_FMT_xxx
+	} Bigs[DISP_BIGNUMS];
+#endif
+#ifdef DISP_MEGACARD
+	// Balken (siehe display_BarDefine)
+	// Pixelzahl der angebrochenen Stelle im CGRAM, 0xFF = unbekannt (nach Init/Define)
+	struct
+	{
+		uint8_t Ix;					// Index des ersten Zeichens im Anzeigespeicher
+		uint8_t Width;				// Anzahl Stellen, 0 = Balken nicht angelegt
+		uint8_t Glyph;				// Pixel der angebrochenen Stelle, die das CGRAM-Zeichen zeigen soll
+		uint8_t Loaded;				// Pixel, die das CGRAM-Zeichen tatschlich zeigt
+	} Bars[DISP_BARS];
+#endif
+} display_t;
+
+#ifdef DISP_MULTI
+// Mehrere Anzeigen (DISP_MULTI)
+// Jede Instanz hat eigenen Anzeigespeicher, Cursor, Felder und Back-Buffer. Balken gehen
+// nur auf einem HD44780, groe Ziffern nur auf einem Nokia, sonst wird Define ignoriert.
+// RAM pro Instanz: 17 Bytes + 2*DISP_INIT_STAGES + 3*DISP_FIELDS (+ 4*DISP_BARS mit
+// DISP_MEGACARD, + 3*DISP_BIGNUMS mit DISP_BIGNUM, + 3 mit DISP_BACKBUFFER), dazu der
+// Puffer mit DISP_BUF_LEN Bytes. Die Funktionstabellen kosten je 12 Bytes.
+// Gegenber einer Anzeige kostet jeder Zugriff eine Zeigeroperation und jeder HW-Zugriff
+// einen indirekten Aufruf.
+#ifdef DISP_BACKBUFFER
+#define DISP_BUF_LEN(lines,cols) (2*(lines)*(cols))
+#else
+#define DISP_BUF_LEN(lines,cols) ((lines)*(cols))
+#endif
+
+#ifdef DISP_MEGACARD
+extern const display_ops_t display_OpsLcd;
+#endif
+#ifdef DISP_NOKIA
+extern const display_ops_t display_OpsNokia;
+#endif
+
+// Eine Instanz fr den Typ ops anlegen, buf muss DISP_BUF_LEN(ops.Lines,ops.Cols) Bytes haben
+// Danach wie bei einer Anzeige mit display_InitStart/display_InitTask initialisieren.
+// Mehrere Instanzen desselben Typs teilen sich die Leitungen, sinnvoll ist eine pro Typ.
+void display_Create(display_t *d, const display_ops_t *ops, uint8_t *buf);
+
+// Die Instanz auswhlen, auf die alle brigen display_ Funktionen (und stdout) wirken
+// Muss vor dem ersten Zugriff aufgerufen werden.
+void display_Select(display_t *d);
+#endif
 